@@ -3,6 +3,7 @@
 
 #include <opencv2/core/core.hpp>
 #include <vector>
+#include <unordered_map>
 
 #include <AprilTags/TagFamily.h>
 
@@ -55,6 +56,14 @@ namespace cv {
      bool hasId( unsigned int id ) const;
      bool idLocation( unsigned int id, Point3f &pt  ) const;
 
+     // Finds the shift between a grid of detected ids (CV_16S, -1 where
+     // there is no detection) and the board which matches the most ids, by
+     // having each detected id vote for the offsets implied by the board
+     // position(s) carrying that id.  ids(y,x) sits on board position
+     // (x,y) + offset.
+     //
+     // Returns the board location (CV_32FC3, from locationAt()) of each
+     // element of ids;  valid marks those which fall on the board.
      Mat mostLikelyAlignment( const Mat &ids, Mat &valid );
 
     private:
@@ -66,6 +75,9 @@ namespace cv {
     TagFamily _tagFamily;
     Mat _tags;
 
+    // Board position(s) of each code id, in (i,j) order
+    std::unordered_map< unsigned int, vector< cv::Point2i > > _idPositions;
+
 int calculateDistance( const Mat &ids, const Point2i &offset );
 
   };
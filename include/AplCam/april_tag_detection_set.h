@@ -1,5 +1,5 @@
 #ifndef __APRIL_TAG_DETECTION_SET_H__
-#define __APTIL_TAG_DETECTION_SET_H__
+#define __APRIL_TAG_DETECTION_SET_H__
 
 #include <vector>
 
@@ -23,7 +23,8 @@ class AprilTagDetectionSet {
 
     AprilTagDetectionSet( const vector<TagDetection> detections );
 
-    cv::Mat gridOfIds( void );
+    // Computed once, when the grid is assembled
+    cv::Mat gridOfIds( void ) const { return _ids; }
     cv::Mat gridOfIndices( void ) const { return _grid; }
 
     const TagDetection &operator[]( int idx ) const { return _detections[idx]; }
@@ -37,18 +38,18 @@ class AprilTagDetectionSet {
     bool validAt( int x, int y ) const
     { return indexAt(x,y) >= 0; }
 
-    int gridCount( void ) const;
+    int gridCount( void ) const { return _gridCount; }
 
 
   private:
 
     void arrangeIntoGrid( void );
 
-    void assignToGraph( const vector<DetectionNode> &nodes, const int idx,
-                        cv::Mat &graph, const int x, const int y, int *limits );
+    void assignToGrid( const vector<DetectionNode> &nodes, const int seed );
 
     const vector<TagDetection> _detections;
-    cv::Mat _grid;
+    cv::Mat _grid, _ids;
+    int _gridCount;
 
 };
 
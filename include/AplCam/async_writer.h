@@ -0,0 +1,87 @@
+#ifndef __APLCAM_ASYNC_WRITER_H__
+#define __APLCAM_ASYNC_WRITER_H__
+
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <memory>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+#include "AplCam/work_queue.h"
+
+namespace AplCam {
+
+  using std::string;
+  using cv::Mat;
+  using cv::Size;
+
+  // Output stage for the splitter and friends.  Image writes are queued
+  // to a pool of threads so several JPEG encodes run at once;  video
+  // frames go to a single thread (VideoWriter needs them in order) with
+  // its own queue.  Both queues are bounded:  when the encoders fall
+  // behind, writeImage() / writeVideo() block rather than buffering
+  // frames without limit.
+  //
+  // Images are copied on submission, as sources are free to reuse the
+  // buffer for the next frame.
+  class AsyncFrameWriter {
+    public:
+
+      // numThreads <= 0 uses the number of hardware threads
+      AsyncFrameWriter( int numThreads = 0, size_t queueDepth = 16 );
+      ~AsyncFrameWriter();
+
+      void writeImage( const string &filename, const Mat &img );
+
+      bool openVideo( const string &filename, int fourcc, double fps, const Size &sz );
+      bool isVideoOpened( void ) const { return (bool)_video; }
+      void writeVideo( const Mat &img );
+
+      // Block until everything queued has been written, then stop the
+      // worker threads.  Called by the destructor if needed.
+      void finish( void );
+
+      struct Stats {
+        Stats( void ) : count(0), busySec(0), blockedSec(0) {;}
+
+        unsigned int count;
+        // Time spent encoding, summed over threads
+        double busySec;
+        // Time the producer waited on a full queue
+        double blockedSec;
+      };
+
+      Stats imageStats( void ) const;
+      Stats videoStats( void ) const;
+
+      void logStats( void ) const;
+
+    protected:
+
+      void writeVideoFrames( void );
+
+      std::unique_ptr< WorkerPool > _imagePool;
+
+      std::unique_ptr< cv::VideoWriter > _video;
+      std::unique_ptr< BoundedQueue< Mat > > _videoQueue;
+      std::thread _videoThread;
+
+      size_t _queueDepth;
+      bool _finished;
+
+      mutable std::mutex _statsMutex;
+      Stats _imageStats, _videoStats;
+      std::atomic< unsigned int > _errors;
+
+    private:
+
+      AsyncFrameWriter( const AsyncFrameWriter & );
+      AsyncFrameWriter &operator=( const AsyncFrameWriter & );
+  };
+
+}
+
+#endif
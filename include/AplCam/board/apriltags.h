@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <string>
+#include <algorithm>
 
 #include <opencv2/core/core.hpp>
 
@@ -30,6 +31,7 @@ namespace AplCam {
     AprilTagsBoard( const Mat &ids, float squares, const std::string &name,  bool doSubtags = false );
 
     virtual Detection *detectPattern( const cv::Mat &gray );
+    virtual Detection *detect( PreparedFrame &frame );
     Detection *attemptSubtagDetection( const cv::Mat &gray, std::vector<AprilTags::TagDetection> &detections );
 
     virtual std::vector< int > ids( void );
@@ -45,10 +47,17 @@ namespace AplCam {
     void setTagSize( float width, float height = -1 );
     void setBlackBorder( unsigned int border );
 
+    // Find tags on an image downscaled by this factor, then refine the
+    // tag corners on the full-resolution image.  1 (default) disables.
+    void setDecimation( int d ) { _decimation = std::max( 1, d ); }
+    int decimation( void ) const { return _decimation; }
+
    protected:
 
     // virtual void loadCallback( cv::FileStorage &fs );
 
+    std::vector<AprilTags::TagDetection> extractDecimated( const cv::Mat &gray ) const;
+
    private:
 
     cv::Mat _ids;
@@ -57,6 +66,7 @@ namespace AplCam {
 
     unsigned int _blackBorder;
     cv::Size2f _tagSize;
+    int _decimation;
   };
 
 }
@@ -15,6 +15,7 @@ enum Pattern { CHESSBOARD,
 
 // Forward decl
 struct Detection;
+class PreparedFrame;
 
 using AplCam::ObjectPointsVec;
 using AplCam::ImagePointsVec;
@@ -24,7 +25,8 @@ using cv::Mat;
   class Board {
    public:
     Board( Pattern pat, int w, int h, float squares, const std::string &nam )
-        : name(nam), pattern(pat), width(w), height(h), squareSize( squares )
+        : name(nam), pattern(pat), width(w), height(h), squareSize( squares ),
+          _expectedSquarePx( -1 ), _maxDecimation( 3 ), _lastSquarePx( -1 )
     {;}
 
     virtual ~Board() {;}
@@ -38,6 +40,24 @@ using cv::Mat;
 
     virtual Detection *detectPattern( const Mat &gray );
 
+    // As detectPattern(), drawing gray, pyramid etc. from the frame's
+    // cache so they're shared with other consumers of the same frame
+    virtual Detection *detect( PreparedFrame &frame );
+
+    // Chessboards are found on an image decimated so squares are still
+    // MinDecimatedSquare pixels across, then refined at full resolution.
+    // The expected square size (in pixels) is taken from the last
+    // successful detection, this hint, or the image size, in that order.
+    //
+    // Because each chessboard detection updates that state, a Board is
+    // not safe to call from several threads at once;  give each thread
+    // its own.
+    void setExpectedSquarePixels( float px ) { _expectedSquarePx = px; }
+    // 0 always searches at full resolution
+    void setMaxDecimation( int levels )      { _maxDecimation = levels; }
+
+    static const float MinDecimatedSquare;
+
     //typedef enum { BOARD_UL, BOARD_CENTER } CornersReference;
 
     virtual void draw( cv::Mat &img, Detection *detection ) const;
@@ -84,6 +104,13 @@ using cv::Mat;
 
     virtual void loadCallback( cv::FileStorage &fs ) {;}
 
+    Detection *detectChessboard( PreparedFrame &frame );
+    int chessboardDecimation( const cv::Size &imgSize ) const;
+
+    float _expectedSquarePx;
+    int _maxDecimation;
+    float _lastSquarePx;
+
    private:
   };
 
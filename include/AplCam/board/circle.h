@@ -14,37 +14,105 @@ namespace AplCam {
 class CircleBoard : public Board {
  public:
   CircleBoard( const std::string &nam )
-      : Board( CIRCLE, 1, 1, 0.0, nam )
+      : Board( CIRCLE, 1, 1, 0.0, nam ),
+        _minRadius( 0 ), _maxRadius( 0 ), _searchRegion()
   {;}
 
   CircleBoard( Pattern pat, const std::string &nam )
-      : Board( pat, 1, 1, 0.0, nam )
+      : Board( pat, 1, 1, 0.0, nam ),
+        _minRadius( 0 ), _maxRadius( 0 ), _searchRegion()
   {;}
 
   virtual ~CircleBoard() {;}
 
   virtual Detection *detectPattern( const cv::Mat &gray );
+  virtual Detection *detect( PreparedFrame &frame );
+
+  // Expected circle radius, in pixels.  The Hough accumulator only votes
+  // over this range;  max <= 0 searches all radii.  May also be given as
+  // "min_radius" / "max_radius" in the board file.
+  void setRadiusRange( int minRadius, int maxRadius )
+  { _minRadius = minRadius;  _maxRadius = maxRadius; }
+
+  // Only search this part of the image;  an empty Rect searches it all
+  void setSearchRegion( const cv::Rect &roi ) { _searchRegion = roi; }
+
+  int minRadius( void ) const { return _minRadius; }
+  int maxRadius( void ) const { return _maxRadius; }
+  const cv::Rect &searchRegion( void ) const { return _searchRegion; }
 
  protected:
 
   virtual void loadCallback( cv::FileStorage &fs );
 
+  int _minRadius, _maxRadius;
+  cv::Rect _searchRegion;
+
  private:
 };
 
 
+// How closely each pixel of an image matches a target hue, weighted by
+// saturation and value:  ((1 + cos(h - target))/2 * s * v)^2.  The
+// product is formed in 8 bits, the cosine term coming from a lookup table
+// over the 180 8-bit hue values;  the square is 16 bits, so weak matches
+// aren't lost before FindCircles() normalizes.  All steps are LUT and
+// multiply over whole rows.
+class HueWeighting {
+ public:
+  // Hue in degrees, [0,360)
+  HueWeighting( float hueDeg = 0 );
+
+  // Hue, in degrees, of a BGR color
+  static float HueOf( const cv::Scalar &bgr );
+
+  float hue( void ) const { return _hueDeg; }
+
+  // hsv is CV_8UC3 from cvtColor( ..., CV_BGR2HSV ).  weight is
+  // (re)allocated as CV_16UC1, full scale 255^2
+  void apply( const cv::Mat &hsv, cv::Mat &weight ) const;
+
+  // Evaluate several hues in one pass over hsv:  the s*v product is
+  // shared, and each pixel is read once for all targets.  weights[i]
+  // matches weightings[i]->apply() to within rounding.  Row bands run in parallel.
+  static void ApplyAll( const cv::Mat &hsv, const std::vector< const HueWeighting * > &weightings,
+                        std::vector< cv::Mat > &weights );
+
+ protected:
+
+  float _hueDeg;
+
+  // 1x256, for cv::LUT:  CV_8UC1 and CV_16UC1
+  cv::Mat _hueLut, _squareLut;
+};
+
+
 class ColorSegmentationCircleBoard : public CircleBoard {
  public:
-  ColorSegmentationCircleBoard( const std::string &name )
-      : CircleBoard( COLOR_SEG_CIRCLE, name )
-  {;}
+  ColorSegmentationCircleBoard( const std::string &name );
 
   virtual Detection *detectPattern( const cv::Mat &gray );
 
+  // Works from the color image, so nothing to share
+  virtual Detection *detect( PreparedFrame &frame );
+
+  // If set, intermediate images are written to this directory.  Off by
+  // default;  nothing is ever displayed.
+  void setDebugDirectory( const std::string &dir ) { _debugDir = dir; }
+  const std::string &debugDirectory( void ) const { return _debugDir; }
+
+  // Find circles in a hue weighting image from HueWeighting::apply(),
+  // which is normalized to 8 bits in place.  tag names the debug images,
+  // if debugDir is set.
+  static Detection *FindCircles( cv::Mat &weight,
+                                 const std::string &debugDir, const std::string &tag );
+
  protected:
 
   virtual void loadCallback( cv::FileStorage &fs );
 
+  HueWeighting _weighting;
+  std::string _debugDir;
 };
 
 
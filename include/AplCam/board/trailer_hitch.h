@@ -10,22 +10,28 @@ namespace AplCam {
     TrailerHitch( const std::string &name );
     virtual ~TrailerHitch();
 
+    // Evaluates every target from one HSV conversion and searches each
+    // target's weighting in parallel.  The result holds every circle
+    // found, plus one point for the strongest circle of each target that
+    // was found, with the target's index as its id.
     virtual Detection *detectPattern( const cv::Mat &gray );
 
+    const std::string &targetName( int id ) const { return _targets[id].name; }
+
     virtual void to_json( json &j ) const;
     virtual void from_json( const json &j );
 
    protected:
 
      struct HueTarget {
+       // Hue in degrees
        HueTarget( const std::string &n, unsigned int hue = 0 )
-        : _hue(hue), name(n) {;}
+        : _hue(hue), _weighting( hue ), name(n) {;}
 
        virtual ~HueTarget() {;}
 
-       virtual Detection *detectPattern( const cv::Mat &img ) const;
-
        unsigned int _hue;
+       HueWeighting _weighting;
 
        std::string name;
      };
@@ -0,0 +1,96 @@
+#ifndef __APLCAM_BOARD_TRACKER_H__
+#define __APLCAM_BOARD_TRACKER_H__
+
+#include <memory>
+
+#include <opencv2/core/core.hpp>
+
+#include "AplCam/board/board.h"
+#include "AplCam/detection/detection.h"
+#include "AplCam/motion_model.h"
+#include "AplCam/prepared_frame.h"
+
+namespace AplCam {
+
+  // Tracking-assisted detection for video.  The board's image region is
+  // predicted from the previous detection (board extents projected through
+  // Detection::boardToImageH(), centered by a DecayingVelocityMotionModel),
+  // and Board::detect() runs on that crop first.  The full frame is
+  // only searched when there is no prediction or the crop comes back with
+  // too few points.
+  //
+  // Detections are returned in full-frame coordinates.
+  class BoardTracker {
+    public:
+
+      struct Params {
+        Params( void )
+          : margin( 0.25 ), minPad( 32 ), minPoints( 4 ),
+            keepFraction( 0.5 ), maxCropFraction( 0.6 ), maxMisses( 3 )
+        {;}
+
+        // Crop is the predicted region grown by margin * its size on each
+        // side, plus three sigma of the motion model's position uncertainty,
+        // but never less than minPad pixels
+        float margin;
+        int minPad;
+
+        // A crop succeeds if it has at least minPoints points and at least
+        // keepFraction of the previous detection's points
+        int minPoints;
+        float keepFraction;
+
+        // Crops bigger than this fraction of the frame aren't worth it
+        float maxCropFraction;
+
+        // Frames without a detection before the track is dropped
+        int maxMisses;
+      };
+
+      BoardTracker( Board &board, const Params &params = Params() );
+
+      // Caller owns the result, which may be NULL as from Board::detect().
+      // The full-frame search uses the frame's cached gray, pyramid etc.
+      Detection *detect( PreparedFrame &frame );
+
+      Detection *detect( const cv::Mat &img )
+      { PreparedFrame frame( img );  return detect( frame ); }
+
+      void reset( void );
+
+      bool tracking( void ) const { return (bool)_motion; }
+
+      // Region searched first on the most recent frame, empty if none
+      const cv::Rect &lastCrop( void ) const { return _lastCrop; }
+
+      struct Stats {
+        Stats( void ) : frames(0), cropHits(0), cropMisses(0), fullFrame(0) {;}
+        unsigned int frames, cropHits, cropMisses, fullFrame;
+      };
+
+      const Stats &stats( void ) const { return _stats; }
+
+    protected:
+
+      bool predict( const cv::Size &imgSize, cv::Rect &crop );
+      void update( const Detection &det );
+      bool acceptable( const Detection *det ) const;
+
+      // Image-space bounding box of the board for a detection
+      bool boardRegion( const Detection &det, cv::Rect_<float> &region ) const;
+
+      Board &_board;
+      Params _params;
+
+      std::unique_ptr< DecayingVelocityMotionModel > _motion;
+      cv::Size2f _regionSize;
+      unsigned int _lastCount;
+      int _misses;
+
+      cv::Rect _lastCrop;
+      Stats _stats;
+  };
+
+}
+
+#endif
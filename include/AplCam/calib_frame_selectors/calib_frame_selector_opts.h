@@ -11,7 +11,7 @@
 #include <tclap/CmdLine.h>
 #include <glog/logging.h>
 
-#include "AplCam/calib_frame_selectors.h"
+#include "AplCam/calib_frame_selectors/calib_frame_selectors.h"
 
 namespace AplCam {
 
@@ -31,7 +31,11 @@ namespace AplCam {
           startArg( "", "start-frame", "Start", false, 0, "Start", cmd ),
           endArg("", "end-frame", "End", false, INT_MAX, "End", cmd ),
           intervalArg("", "interval", "Interval", false, 0, "Interval (in frames)", cmd ),
-          minTagsArg("", "min-tags", "Minimum number of tags", false, -1, "Number of tags", cmd )
+          minTagsArg("", "min-tags", "Minimum number of tags", false, -1, "Number of tags", cmd ),
+          gridWidthArg("", "grid-width", "Coverage grid columns", false, 16, "cells", cmd ),
+          gridHeightArg("", "grid-height", "Coverage grid rows", false, 12, "cells", cmd ),
+          depthArg("", "depth", "Frames needed to cover a coverage cell", false, 1, "frames", cmd ),
+          poseBinsArg("", "pose-bins", "Board tilt direction bins for coverage (0 to ignore pose)", false, 0, "bins", cmd )
           {;}
 
         FrameSelector *construct( void )
@@ -51,6 +55,21 @@ namespace AplCam {
             }
 
             return new IntervalFrameSelector( startArg.getValue(), intervalArg.getValue(), endArg.getValue(), minTagsArg.getValue() );
+          } else if( selector.compare("coverage") == 0 ) {
+            if( ! randomCountArg.isSet() ) {
+              LOG(ERROR) << "--count not set for coverage selector";
+              return NULL;
+            }
+
+            if( gridWidthArg.getValue() < 1 || gridHeightArg.getValue() < 1 ||
+                depthArg.getValue() < 1 || poseBinsArg.getValue() < 0 ) {
+              LOG(ERROR) << "Coverage grid and depth must be positive, pose bins non-negative";
+              return NULL;
+            }
+
+            return new CoverageFrameSelector( randomCountArg.getValue(), minTagsArg.getValue(), cv::Size(0,0),
+                                              cv::Size( gridWidthArg.getValue(), gridHeightArg.getValue() ),
+                                              depthArg.getValue(), poseBinsArg.getValue() );
           } else if( selector.compare("all-good") == 0 ) {
             return new AllGoodFrameSelector( minTagsArg.getValue() );
           } else if( selector.compare("all") == 0 ) {
@@ -65,6 +84,7 @@ namespace AplCam {
 
         TCLAP::ValueArg< std::string > selectorArg;
         TCLAP::ValueArg< int > randomCountArg, startArg, endArg, intervalArg, minTagsArg;
+        TCLAP::ValueArg< int > gridWidthArg, gridHeightArg, depthArg, poseBinsArg;
 
     };
 
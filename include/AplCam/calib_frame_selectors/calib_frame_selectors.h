@@ -33,7 +33,7 @@ namespace AplCam {
 
         bool minTagCriteriaGiven( void ) { return _minTags > 0; }
 
-        bool hasMinTags( Detection *det )
+        bool hasMinTags( const Detection *det )
         {
           return (det->size() >= _minTags);
         }
@@ -107,10 +107,18 @@ namespace AplCam {
 
 
 
+    // Single pass reservoir sample of the frames in the db which pass the
+    // minTags test.  Each selector has its own seed, so repeated
+    // generate()s with the same seed give the same subset, and several
+    // selectors can sample one db concurrently.
     class RandomFrameSelector : public FrameSelector {
       public:
         RandomFrameSelector( int c, int minTags = -1 )
-          : FrameSelector( minTags ), _count( c )
+          : FrameSelector( minTags ), _count( c ), _seed( std::random_device()() )
+        {;}
+
+        RandomFrameSelector( int c, int minTags, unsigned long seed )
+          : FrameSelector( minTags ), _count( c ), _seed( seed )
         {;}
 
 
@@ -121,9 +129,13 @@ namespace AplCam {
 
         virtual void generate( DetectionDb &db, DetectionSet &set );
 
+        unsigned long seed( void ) const { return _seed; }
+        void setSeed( unsigned long s ) { _seed = s; }
+
       protected:
 
         long int _count;
+        unsigned long _seed;
     };
 
     class IntervalFrameSelector : public FrameSelector {
@@ -173,6 +185,39 @@ namespace AplCam {
 
     };
 
+    // Greedily picks the frames which add the most coverage of the image
+    // plane, binned into a grid.  Each cell counts as covered once
+    // "depth" selected frames have points in it.  If poseBins > 0, the
+    // board's tilt (direction and magnitude, from its homography) is
+    // binned and treated as additional cells.
+    //
+    // Coverage is submodular, so a frame's gain can only shrink as others
+    // are selected;  a lazy-greedy priority queue re-evaluates only the
+    // top candidates rather than every frame at every step.
+    class CoverageFrameSelector : public FrameSelector {
+      public:
+        CoverageFrameSelector( int count, int minTags = -1,
+                               const cv::Size &imageSize = cv::Size(0,0),
+                               const cv::Size &grid = cv::Size(16,12),
+                               int depth = 1, int poseBins = 0 )
+          : FrameSelector( minTags ), _count( count ), _imageSize( imageSize ),
+            _grid( grid ), _depth( depth ), _poseBins( poseBins )
+        {;}
+
+        virtual void generate( DetectionDb &db, DetectionSet &set );
+
+      protected:
+
+        // Unique cell indices touched by a detection
+        void cells( const Detection &det, const cv::Size &imageSize, vector< int > &out ) const;
+
+        long int _count;
+        cv::Size _imageSize, _grid;
+        int _depth, _poseBins;
+
+        static const int TiltMagnitudeBins = 3;
+    };
+
 
 
 
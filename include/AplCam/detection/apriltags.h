@@ -25,6 +25,8 @@ namespace AplCam {
 
     virtual Detection::Validate_Return_Code validate( void );
 
+    virtual void offset( const ImagePoint &d );
+
   };
 
 }
@@ -23,6 +23,8 @@ using std::string;
 
     virtual void drawCorners(  const Board &board, cv::Mat &view ) const;
 
+    virtual void offset( const ImagePoint &d );
+
     vector< cv::Vec3f > _circles;
   };
 
@@ -57,6 +57,11 @@ namespace AplCam {
       ids.push_back( id );
     }
 
+    // Reorder points, corners and ids by ascending id.  Detectors should
+    // do this once the detection is complete so sharedWith() is a merge.
+    void sortById( void );
+    bool isSortedById( void ) const;
+
     // virtual void calculateCorners( const Board &board );
     //virtual void drawCorners(  const Board &board, cv::Mat &view ) const;
     virtual void draw(  cv::Mat &img ) const;
@@ -71,6 +76,10 @@ namespace AplCam {
 
     cv::Mat boardToImageH( void ) const;
 
+    // Shift all image-space results by d, e.g. from a crop back to the
+    // full frame.  Subclasses holding other image coordinates extend this.
+    virtual void offset( const ImagePoint &d );
+
     static Detection *unserialize( const std::string &str );
     static Detection *loadCache( const std::string &cacheFile );
     static Detection *unserializeFromFileStorage( const cv::FileStorage &fs );
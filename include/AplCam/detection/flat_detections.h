@@ -0,0 +1,112 @@
+#pragma once
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "AplCam/types.h"
+#include "AplCam/detection/detection.h"
+
+namespace AplCam {
+
+  using std::vector;
+
+  // Read-only window onto a contiguous run of T.  Does not own the data;
+  // only valid as long as the FlatDetections (or archive) it came from.
+  template< typename T >
+  struct ArrayView {
+    ArrayView( void ) : _data( NULL ), _size( 0 ) {;}
+    ArrayView( const T *data, size_t sz ) : _data( data ), _size( sz ) {;}
+
+    typedef const T *const_iterator;
+
+    const T *data( void ) const  { return _data; }
+    size_t size( void ) const    { return _size; }
+    bool empty( void ) const     { return _size == 0; }
+
+    const_iterator begin( void ) const { return _data; }
+    const_iterator end( void ) const   { return _data + _size; }
+
+    const T &operator[]( size_t i ) const { return _data[i]; }
+
+    // Deep copy, for the APIs which still want a vector
+    vector< T > vec( void ) const { return vector< T >( begin(), end() ); }
+
+    const T *_data;
+    size_t _size;
+  };
+
+  typedef ArrayView< ImagePoint >  ImagePointsView;
+  typedef ArrayView< ObjectPoint > ObjectPointsView;
+  typedef ArrayView< int >         IdsView;
+
+  // The points, corners and ids of one frame
+  struct DetectionView {
+    DetectionView( void ) : frame( -1 ) {;}
+
+    int frame;
+    ImagePointsView points;
+    ObjectPointsView corners;
+    IdsView ids;
+
+    size_t size( void ) const { return points.size(); }
+
+    // Zero-copy cv::Mat headers (CV_32FC2, CV_32FC3) over the view
+    cv::Mat pointsMat( void ) const;
+    cv::Mat cornersMat( void ) const;
+  };
+
+  // Structure-of-arrays storage for many frames of detections.  Image
+  // points, object points and ids for all frames are each held in one
+  // contiguous array;  frame i occupies [offset(i), offset(i+1)).
+  class FlatDetections {
+    public:
+
+      FlatDetections( void )
+        : _points(), _corners(), _ids(), _offsets( 1, 0 ), _frames()
+      {;}
+
+      void reserve( size_t frames, size_t points );
+      void clear( void );
+
+      void add( const Detection &det, int frame );
+
+      // Append a frame from another FlatDetections (or an archive);
+      // view must not point into this one
+      void add( const DetectionView &view );
+
+      // Keep only the frames for which keep[i] is true
+      void compact( const vector< bool > &keep );
+
+      size_t size( void ) const         { return _frames.size(); }
+      bool empty( void ) const          { return _frames.empty(); }
+      size_t totalPoints( void ) const  { return _points.size(); }
+
+      size_t offset( size_t i ) const   { return _offsets[i]; }
+      size_t count( size_t i ) const    { return _offsets[i+1] - _offsets[i]; }
+      int frame( size_t i ) const       { return _frames[i]; }
+
+      DetectionView operator[]( size_t i ) const;
+
+      const ImagePointsVec  &points( void ) const  { return _points; }
+      const ObjectPointsVec &corners( void ) const { return _corners; }
+      const vector< int >   &ids( void ) const     { return _ids; }
+      const vector< int >   &frames( void ) const  { return _frames; }
+
+      // Materialize per-frame vectors, for APIs (e.g. cv::calibrateCamera)
+      // which require them
+      ImagePointsVecVec imagePointsVecVec( void ) const;
+      ObjectPointsVecVec objectPointsVecVec( void ) const;
+
+    protected:
+
+      ImagePointsVec _points;
+      ObjectPointsVec _corners;
+      vector< int > _ids;
+
+      // size() + 1 entries
+      vector< size_t > _offsets;
+      vector< int > _frames;
+  };
+
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include <opencv2/core/core.hpp>
+
+#include "AplCam/detection/flat_detections.h"
+#include "AplCam/detection_db.h"
+
+namespace AplCam {
+
+  // Packed, read-only binary archive of detections.
+  //
+  // The file is a fixed header (video metadata and section offsets), a
+  // frame index (sorted frame numbers and point offsets), then flat
+  // image point, object point and id arrays -- the same layout as
+  // FlatDetections.  The reader mmap()s the file and hands out
+  // DetectionViews which point straight into the mapping, so opening
+  // is O(1) and processes reading the same archive share the page cache.
+  //
+  // Data are in host byte order;  the header records the byte order so
+  // a foreign archive is rejected rather than misread.
+  class DetectionArchive {
+  public:
+
+    static const uint32_t Version = 1;
+
+    struct Header {
+      char magic[8];
+      uint32_t version;
+      uint32_t byteOrder;
+      uint32_t headerSize;
+
+      float fps;
+      int32_t width, height;
+      uint32_t length;
+
+      uint64_t numFrames, numPoints;
+
+      // Byte offsets from the start of the file
+      uint64_t framesOffset, offsetsOffset;
+      uint64_t pointsOffset, cornersOffset, idsOffset;
+      uint64_t fileSize;
+    };
+
+    DetectionArchive( void );
+    DetectionArchive( const std::string &filename );
+    ~DetectionArchive();
+
+    bool open( const std::string &filename );
+    void close( void );
+    bool isOpen( void ) const { return _header != NULL; }
+
+    //-- Metadata --  (zero if no archive is open)
+    float fps( void ) const             { return _header ? _header->fps : 0; }
+    cv::Size imageSize( void ) const    { return _header ? cv::Size( _header->width, _header->height ) : cv::Size(); }
+    unsigned int length( void ) const   { return _header ? _header->length : 0; }
+
+    size_t size( void ) const           { return _header ? _header->numFrames : 0; }
+    size_t totalPoints( void ) const    { return _header ? _header->numPoints : 0; }
+
+    //-- Access --
+    int frame( size_t i ) const         { return _frames[i]; }
+
+    // View of the i'th frame in the archive (in frame order)
+    DetectionView operator[]( size_t i ) const;
+
+    // Binary search on frame number.  Returns false if not present
+    bool find( int frame, DetectionView &view ) const;
+
+    //-- Writing --
+    static bool Write( const std::string &filename, const FlatDetections &detections,
+                       unsigned int length, const cv::Size &imageSize, float fps );
+
+    static bool Write( const std::string &filename, const FrameIndexedDetectionDb &db );
+
+  protected:
+
+    // Non-copyable
+    DetectionArchive( const DetectionArchive & );
+    DetectionArchive &operator=( const DetectionArchive & );
+
+    bool validate( size_t fileSize ) const;
+
+    void *_map;
+    size_t _mapSize;
+
+    const Header *_header;
+    const int32_t *_frames;
+    const uint64_t *_offsets;
+    const ImagePoint *_points;
+    const ObjectPoint *_corners;
+    const int32_t *_ids;
+  };
+
+}
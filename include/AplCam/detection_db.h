@@ -3,6 +3,8 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <algorithm>
+#include <functional>
 
 #include <opencv2/core/core.hpp>
 
@@ -34,10 +36,118 @@ namespace AplCam {
        virtual bool insert( const std::string &frame, const std::shared_ptr<Detection> &detection ) = 0;
        virtual std::shared_ptr<Detection> at( const std::string &frame ) = 0;
 
+       // Integer frame access.  By default these go through the string
+       // keys;  FrameIndexedDetectionDb implements them directly.
+       virtual bool insertFrame( int frame, const Detection &detection );
+       virtual std::shared_ptr<Detection> atFrame( int frame );
+
+       // Calls visit( frame, detection ) for each frame with a detection,
+       // in frame order.  The detection is only valid during the call.
+       // By default this goes through atFrame() over [0,vidLength()), and
+       // returns false without visiting anything if vidLength() is
+       // unknown;  FrameIndexedDetectionDb visits its storage directly,
+       // without copies.
+       typedef std::function< void( int, const Detection & ) > FrameVisitor;
+       virtual bool visitFrames( const FrameVisitor &visit );
+
        virtual bool setMeta( unsigned int length, int width, int height, float fps ) = 0;
 
+       // Frames [0,vidLength()) may be queried with atFrame().  Zero if
+       // unknown.
+       virtual unsigned int vidLength( void ) const { return 0; }
+       virtual cv::Size imageSize( void ) const     { return cv::Size(0,0); }
+
+       static std::string FrameToKey( int frame );
+       static bool KeyToFrame( const std::string &key, int &frame );
+
+  };
+
+
+  // Detections indexed directly by (dense, non-negative) frame number.
+  // Stored by value in a vector with a presence bitmap, so lookup is O(1),
+  // iteration is sequential in memory, and there's no per-frame key or
+  // control block.  Note detections are stored as the base Detection.
+  //
+  // The string-keyed DetectionDb API is an adapter over this;  keys must
+  // parse as integers.
+  //
+  // Storage grows to the highest frame inserted, so inserts are bounded:
+  // by the length given to setMeta() if there is one, otherwise to at
+  // most MaxFrameGap past the current end.
+  class FrameIndexedDetectionDb : public DetectionDb {
+  public:
+
+    static const size_t MaxFrameGap;
+
+    FrameIndexedDetectionDb( );
+    virtual ~FrameIndexedDetectionDb();
+
+    virtual bool insert( const std::string &frame, const std::shared_ptr<Detection> &detection );
+    virtual std::shared_ptr<Detection> at( const std::string &frame );
+
+    virtual bool insertFrame( int frame, const Detection &detection );
+    virtual std::shared_ptr<Detection> atFrame( int frame );
+
+    virtual bool visitFrames( const FrameVisitor &visit )
+    { forEach( std::cref( visit ) );  return true; }
+
+    virtual bool setMeta( unsigned int length, int width, int height, float fps );
+
+    virtual unsigned int vidLength( void ) const
+    { return std::max( (size_t)_length, _present.size() ); }
+
+    void reserve( size_t frames );
+
+    bool has( int frame ) const
+    { return frame >= 0 && (size_t)frame < _present.size() && _present[frame]; }
+
+    // NULL if the frame has no detection.  Pointers are invalidated by
+    // insertions past the current end.
+    const Detection *find( int frame ) const
+    { return has( frame ) ? &_detections[frame] : NULL; }
+
+    // One past the highest frame stored
+    size_t endFrame( void ) const { return _present.size(); }
+    size_t count( void ) const    { return _count; }
+
+    template< typename F >
+    void forEach( F func ) const
+    {
+      for( size_t i = 0; i < _present.size(); ++i )
+        if( _present[i] ) func( (int)i, _detections[i] );
+    }
+
+    unsigned int length( void ) const { return _length; }
+    virtual cv::Size imageSize( void ) const  { return _imageSize; }
+    float fps( void ) const           { return _fps; }
+
+  protected:
+
+    vector< Detection > _detections;
+    vector< bool > _present;
+    size_t _count;
+
+    unsigned int _length;
+    cv::Size _imageSize;
+    float _fps;
   };
 
+  void   to_json(json& j, const FrameIndexedDetectionDb& p);
+  void from_json(const json& j, FrameIndexedDetectionDb& p);
+
+
+  // Detection::sharedWith() for the same frames in two dbs (e.g. the two
+  // cameras of a stereo pair).  Detections are fetched serially, then
+  // matched in parallel.  shared[i] corresponds to frames[i] and is
+  // empty if either db lacks that frame.
+  void sharedWith( DetectionDb &a, DetectionDb &b, const vector<int> &frames,
+                   vector< SharedPoints > &shared );
+
+  // As above, for every frame present in both.  Works on the stored
+  // detections directly, without copies.
+  void sharedWith( const FrameIndexedDetectionDb &a, const FrameIndexedDetectionDb &b,
+                   vector<int> &frames, vector< SharedPoints > &shared );
+
 
   class InMemoryDetectionDb;
 
@@ -6,6 +6,7 @@
 #include <string>
 
 #include "AplCam/detection/detection.h"
+#include "AplCam/detection/flat_detections.h"
 #include "AplCam/detection_db.h"
 
 namespace AplCam {
@@ -17,114 +18,71 @@ namespace AplCam {
   class DetectionSet {
     public:
 
-      typedef vector< Detection * > DetectionMap;
-
       DetectionSet()
-        : _name(""), _detections(), _frames()
+        : _name(""), _flat(), _pending()
       {;}
 
-      ~DetectionSet( void )
-      {
-        for( DetectionMap::iterator itr = _detections.begin(); itr != _detections.end(); ++itr ) delete (*itr);
-      }
+      ~DetectionSet( void );
 
-      size_t size( void ) const { return _detections.size(); }
+      size_t size( void ) const { return _flat.size(); }
 
       void addDetection( DetectionDb &db, const int frame )
       {
         //addDetection( db.load( frame ), frame );
       }
 
-      void addDetection( Detection *detection, const int frame )
-      {
-        if( detection ) {
-          _detections.push_back( detection );
-          _frames.push_back( frame );
-        }
-      }
+      // Takes ownership of detection.  Its points are copied into the
+      // flat storage now;  the Detection itself is kept until validate()
+      // so its (virtual) validate() can be run then.
+      void addDetection( Detection *detection, const int frame );
+
+      // Copies the points.  Frames added this way are always kept by
+      // validate().
+      void addDetection( const Detection &detection, const int frame );
+
+      // Copies a frame from other flat storage;  also always kept
+      void addDetection( const DetectionView &view );
+
+      void reserve( size_t frames, size_t points )
+      { _flat.reserve( frames, points ); }
 
+      // Runs Detection::validate() on each frame added by pointer since
+      // the last call, dropping those which fail and the outlier points
+      // validate() removes from the rest.
       int validate( void );
 
 
       //==
+      // These copy out of the flat storage;  prefer flat() / operator[]
       int imageObjectPoints( ImagePointsVecVec &imgPts, ObjectPointsVecVec &objPts ) const
       {
-        int count = 0;
-        for( DetectionMap::const_iterator itr = _detections.begin(); itr != _detections.end(); ++itr ) {
-          const Detection &det( **itr );
-          imgPts.push_back( det.points );
-          objPts.push_back( det.corners );
-          count += det.corners.size();
-        }
-
-        return count;
+        imgPts = _flat.imagePointsVecVec();
+        objPts = _flat.objectPointsVecVec();
+        return _flat.totalPoints();
       }
 
+      ObjectPointsVecVec objectPoints( void ) const
+      { return _flat.objectPointsVecVec(); }
 
-      // Inefficient, for now
-      ObjectPointsVecVec objectPoints( void ) const {
-        ObjectPointsVecVec v;
-        for( DetectionMap::const_iterator itr = _detections.begin(); itr != _detections.end(); ++itr )
-          v.push_back( (*itr)->corners );
-        return v;
-      }
-
-      ImagePointsVecVec imagePoints( void ) const {
-        ImagePointsVecVec v;
-        for( DetectionMap::const_iterator itr = _detections.begin(); itr != _detections.end(); ++itr )
-          v.push_back( (*itr)->points );
-        return v;
-      }
+      ImagePointsVecVec imagePoints( void ) const
+      { return _flat.imagePointsVecVec(); }
 
       RotVec rvecs( void ) const {
         RotVec v;
-        // for( DetectionMap::const_iterator itr = _detections.begin(); itr != _detections.end(); ++itr )
-        //   v.push_back( (*itr)->rot );
         return v;
       }
 
       TransVec tvecs( void ) const {
         TransVec v;
-        // for( DetectionMap::const_iterator itr = _detections.begin(); itr != _detections.end(); ++itr )
-        //   v.push_back( (*itr)->trans );
         return v;
       }
 
+      // Zero-copy view of one frame's points
+      DetectionView operator[]( unsigned int i)  const
+      { return _flat[i]; }
 
-      struct ConstSetElement {
-        ConstSetElement( int f, Detection *det )
-          : frame( f ), _det(det) {;}
-
-        int frame;
-        const Detection *_det;
-
-        operator const Detection &( void ) { return *_det; }
-        operator const Detection *( void ) { return _det; }
-      };
-
-
-      ConstSetElement operator[]( unsigned int i)  const
-      {
-        return ConstSetElement( _frames[i], _detections[i] );
-      }
-
-
-      struct SetElement {
-        SetElement( int f, Detection *det )
-          : frame( f ), _det(det) {;}
-
-        int frame;
-        Detection *_det;
-
-        operator Detection &( void ) { return *_det; }
-        operator Detection *( void ) { return _det; }
-      };
-
-
-      SetElement operator[]( unsigned int i)
-      {
-        return SetElement( _frames[i], _detections[i] );
-      }
+      const FlatDetections &flat( void ) const
+      { return _flat; }
 
 
       const string &setName( const string &n )
@@ -134,14 +92,21 @@ namespace AplCam {
       { return _name; }
 
       const vector<int> &frames( void ) const
-      { return _frames; }
+      { return _flat.frames(); }
 
 
     protected:
       string _name;
 
-      DetectionMap _detections;
-      vector< int > _frames;
+      FlatDetections _flat;
+
+      // One per frame;  the Detection awaiting validate(), or NULL
+      vector< Detection * > _pending;
+
+    private:
+
+      DetectionSet( const DetectionSet & );
+      DetectionSet &operator=( const DetectionSet & );
   };
 
 }
@@ -5,11 +5,13 @@
 
 #include <vector>
 #include <algorithm>
+#include <memory>
 
 #include "AplCam/types.h"
 #include "AplCam/calibration_result.h"
 
 #include "AplCam/distortion/pinhole_camera.h"
+#include "AplCam/distortion/undistortion_table.h"
 
 namespace Distortion {
 
@@ -68,6 +70,24 @@ class DistortionModel : public PinholeCamera {
     // PinholeCamera does nothing
    virtual ImagePointsVec undistortVec( const ImagePointsVec &pw ) const;
 
+  //-- Undistortion lookup table --
+  //
+  // Once built, normalizeUndistort() (and hence normalizeUndistortImage()
+  // and undistortPoints()) interpolate from the table rather than
+  // inverting the distortion model.  Points outside the table fall back
+  // to the exact solution.  The table is ignored if the camera's
+  // coefficients change after it is built.
+
+  void buildUndistortionTable( const Size &imageSize, int step = 8,
+                               UndistortionTable::Interpolation interp = UndistortionTable::BILINEAR );
+  void clearUndistortionTable( void ) { _undistortionTable.reset(); }
+
+  // Returns NULL if there is no table or it is out of date
+  const UndistortionTable *undistortionTable( void ) const;
+
+  virtual ImagePoint     normalizeUndistort( const ImagePoint &pw ) const;
+  virtual ImagePointsVec normalizeUndistort( const ImagePointsVec &pw ) const;
+
   //
 
   enum DistortionModelType_t { CALIBRATION_NONE,
@@ -84,7 +104,10 @@ class DistortionModel : public PinholeCamera {
 
   virtual DistortionModel *estimateMeanCamera( vector< DistortionModel *> cameras ) = 0;
 
+ protected:
 
+  // Shared so copies of a camera can share the (immutable) table
+  std::shared_ptr< UndistortionTable > _undistortionTable;
 
 };
 
@@ -35,12 +35,31 @@ namespace Distortion {
                           double alpha, const Size &newImageSize,
                           Rect &validPixROI1, Rect &validPixROI2 );
 
+  // Undistorts and re-images every view of both cameras.  Views are
+  // processed in parallel.
+  void normalizeUndistortImagePair( const PinholeCamera &cam1, const PinholeCamera &cam2,
+                                    const ImagePointsVecVec &imagePoints1,
+                                    const ImagePointsVecVec &imagePoints2,
+                                    ImagePointsVecVec &undistorted1,
+                                    ImagePointsVecVec &undistorted2 );
+
   bool triangulate( const PinholeCamera &cam1, const PinholeCamera &cam2,
                    const StereoCalibration &calib,
                    ImagePointsVec &_imagePoints1,
                    ImagePointsVec &_imagePoints2,
                    ObjectPointsVec &_worldPoints );
 
+  // Batched triangulation of count corresponding points (in pixels).
+  // Results are written, in double precision, to worldPoints which must
+  // have room for count points.  Each point is solved independently by
+  // linear least squares;  the batch is split across threads.
+  void triangulate( const PinholeCamera &cam1, const PinholeCamera &cam2,
+                    const StereoCalibration &calib,
+                    const ImagePoint *imagePoints1,
+                    const ImagePoint *imagePoints2,
+                    size_t count,
+                    cv::Vec3d *worldPoints );
+
    //void stereoRectify( const PinholeCamera &cam1, const PinholeCamera &cam2,
    //                       const Size &imageSize, const Mat &_Rmat, const Mat &_Tmat,
    //                       Mat &_Rmat1, Mat &_Rmat2,
@@ -11,6 +11,10 @@
 #include "AplCam/types.h"
 #include "AplCam/calibration_result.h"
 
+namespace AplCam {
+  class FlatDetections;
+}
+
 namespace Distortion {
 
   using namespace AplCam;
@@ -72,8 +76,15 @@ namespace Distortion {
 
       virtual Mat coefficientsMat( void ) const = 0;
 
+      // Incremented every time the intrinsics/distortion coefficients
+      // change.  Lets derived data (e.g. an UndistortionTable) tell if
+      // it is stale.
+      unsigned int coefficientsVersion( void ) const { return _coeffsVersion; }
+
     protected:
 
+      void coefficientsChanged( void ) { ++_coeffsVersion; }
+
       virtual bool doCalibrate( const ObjectPointsVecVec &objectPoints,
           const ImagePointsVecVec &imagePoints, const Size& image_size,
           CalibrationResult &result,
@@ -81,7 +92,11 @@ namespace Distortion {
           cv::TermCriteria criteria = cv::TermCriteria(cv::TermCriteria::COUNT+cv::TermCriteria::EPS, 100, DBL_EPSILON)  ) { return false; };
 
       // Private constructor
-      Camera() {;}
+      Camera() : _coeffsVersion(0) {;}
+
+    private:
+
+      unsigned int _coeffsVersion;
   };
 
   class PinholeCamera : public Camera {
@@ -264,10 +279,10 @@ namespace Distortion {
       { return undistortVec( normalize(pw) ); }
 
       virtual ImagePoint     normalizeUndistortImage( const ImagePoint &pw ) const
-      { return image( undistort( normalize(pw) ) ); }
+      { return image( normalizeUndistort(pw) ); }
 
       virtual ImagePointsVec normalizeUndistortImage( const ImagePointsVec &pw ) const
-      { return image( undistortVec( normalize(pw) ) ); }
+      { return image( normalizeUndistort(pw) ); }
 
       virtual ImagePointsVecVec normalizeUndistortImage( const ImagePointsVecVec &pw ) const;
 
@@ -300,6 +315,11 @@ namespace Distortion {
           ReprojErrorVecVec &reprojErrors,
           const vector<bool> mask = vector<bool>() );
 
+      // Works directly on the flat storage, one rvec/tvec per frame
+      double reprojectionError( const FlatDetections &detections,
+          const RotVec &rvecs, const TransVec &tvecs,
+          const vector<bool> mask = vector<bool>() );
+
 
 
 
@@ -45,6 +45,20 @@ virtual Mat coefficientsMat( void ) const;
   virtual ImagePoint undistort( const ImagePoint &pw ) const;
   virtual ImagePoint distort( const ObjectPoint &w ) const ;
 
+  // Batch undistortion.  Rather than calling cv::undistortPoints once per
+  // point, this iterates the inverse of the rational/tangential model over
+  // the whole array at once.
+  virtual ImagePointsVec undistortVec( const ImagePointsVec &pw ) const;
+
+  // Input points __must__ be normalized.  in and out may be the same array.
+  void undistortArray( const ImagePoint *in, ImagePoint *out, size_t n ) const;
+
+  // Iteration count (COUNT) and max. residual in normalized units (EPS)
+  // for the iterative undistortion.
+  void setUndistortCriteria( const cv::TermCriteria &criteria )
+  { _undistortCriteria = criteria;  coefficientsChanged(); }
+  const cv::TermCriteria &undistortCriteria( void ) const { return _undistortCriteria; }
+
   virtual DistortionModel *estimateMeanCamera( vector< DistortionModel *> cameras );
 
   //--- Serialize/Unserialize functions ----
@@ -65,7 +79,12 @@ protected:
   static const Vec8d InitialDistortionEstimate( void )
   { return Vec8d(0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0); }
 
+  // Same defaults as cv::undistortPoints (5 iterations), plus an early-out
+  static const cv::TermCriteria DefaultUndistortCriteria( void )
+  { return cv::TermCriteria( cv::TermCriteria::COUNT+cv::TermCriteria::EPS, 5, 1e-9 ); }
+
   cv::Vec8d _distCoeffs;
+  cv::TermCriteria _undistortCriteria;
 
 };
 
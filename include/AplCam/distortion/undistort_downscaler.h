@@ -0,0 +1,77 @@
+#ifndef __DISTORTION_UNDISTORT_DOWNSCALER_H__
+#define __DISTORTION_UNDISTORT_DOWNSCALER_H__
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "AplCam/distortion/distortion_model.h"
+
+namespace Distortion {
+
+  using std::vector;
+  using cv::Size;
+  using cv::Mat;
+  using cv::Matx33d;
+
+  // Fused undistort + downscale + grayscale.
+  //
+  // The undistortion map is built once, at the _output_ resolution, and
+  // stored as a source offset plus fixed-point bilinear weights for each
+  // output pixel.  Each frame is then a single pass which reads the
+  // 8-bit gray/BGR/BGRA source once and writes the final gray image;
+  // no full-size intermediate images are allocated, and the per-frame
+  // cost scales with the number of output pixels.
+  //
+  // When downscaling by 2x or more, each output pixel averages a 2x2
+  // pattern of bilinear samples to limit aliasing.
+  //
+  // The pass is split into row bands with cv::parallel_for_.
+  class UndistortDownscaler {
+    public:
+
+      UndistortDownscaler( DistortionModel &cam, const Size &srcSize, double scale );
+
+      // src must be CV_8UC1, CV_8UC3 (BGR) or CV_8UC4 (BGRA) of srcSize();
+      // gray is (re)allocated as CV_8UC1 of dstSize()
+      void apply( const Mat &src, Mat &gray ) const;
+
+      void operator()( const Mat &src, Mat &gray ) const
+      { apply( src, gray ); }
+
+      Size srcSize( void ) const   { return _srcSize; }
+      Size dstSize( void ) const   { return _dstSize; }
+      double scale( void ) const   { return _scale; }
+      int samples( void ) const    { return _samples; }
+
+      // Pinhole camera matrix of the output image.  Points found in the
+      // output are undistorted;  normalize them with this.
+      Matx33d cameraMatrix( void ) const { return _K; }
+
+      // One bilinear sample.  (x,y) is the top-left source neighbour;
+      // x is -1 if the sample falls outside the source image.  Weights
+      // sum to (1 << WeightBits).
+      struct Tap {
+        short x, y;
+        unsigned short w[4];
+      };
+
+      static const int WeightBits = 11;
+
+      // Tap for the source location (x,y);  exposed for testing
+      static Tap MakeTap( float x, float y, const Size &srcSize );
+
+    protected:
+
+      Size _srcSize, _dstSize;
+      double _scale;
+      int _samples;
+      Matx33d _K;
+
+      // _samples taps per output pixel, row-major
+      vector< Tap > _taps;
+  };
+
+}
+
+#endif
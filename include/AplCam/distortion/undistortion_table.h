@@ -0,0 +1,75 @@
+#ifndef __DISTORTION_UNDISTORTION_TABLE_H__
+#define __DISTORTION_UNDISTORTION_TABLE_H__
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "AplCam/types.h"
+
+namespace Distortion {
+
+  using namespace AplCam;
+
+  using std::vector;
+  using cv::Size;
+  using cv::Vec2d;
+
+  class PinholeCamera;
+
+  // Precomputed inverse of a camera's distortion.  Stores the normalized,
+  // undistorted location of a regular grid of image (pixel) locations, then
+  // interpolates between grid nodes.  Building the table costs one batch
+  // normalizeUndistort() over the grid;  after that each lookup is a
+  // handful of multiply-adds regardless of the distortion model.
+  //
+  // The table is tied to the coefficients it was built from (see
+  // Camera::coefficientsVersion()), so a camera will ignore a table
+  // built before it was recalibrated or had setCamera() called.
+  class UndistortionTable {
+    public:
+
+      typedef enum { BILINEAR, BICUBIC } Interpolation;
+
+      UndistortionTable( const PinholeCamera &cam, const Size &imageSize,
+                         int step = 8, Interpolation interp = BILINEAR );
+
+      // Pixel in, normalized undistorted point out.  Returns false if
+      // the point lies outside the image area covered by the table
+      bool lookup( const ImagePoint &pixel, ImagePoint &out ) const;
+
+      Size imageSize( void ) const      { return _imageSize; }
+      int step( void ) const            { return _step; }
+      Interpolation interpolation( void ) const { return _interp; }
+      unsigned int version( void ) const { return _version; }
+
+      // Error of the interpolated result against the exact solution,
+      // measured at the center of every grid cell (where interpolation
+      // error peaks).  In normalized units;  multiply by the focal length
+      // for the equivalent in pixels.
+      double maxError( void ) const     { return _maxError; }
+      double rmsError( void ) const     { return _rmsError; }
+
+    protected:
+
+      const Vec2d &node( int x, int y ) const
+      { return _nodes[ y*_cols + x ]; }
+
+      ImagePoint bilinear( int x, int y, double fx, double fy ) const;
+      ImagePoint bicubic( int x, int y, double fx, double fy ) const;
+
+      void estimateError( const PinholeCamera &cam );
+
+      Size _imageSize;
+      int _step, _cols, _rows;
+      Interpolation _interp;
+      unsigned int _version;
+
+      vector< Vec2d > _nodes;
+
+      double _maxError, _rmsError;
+  };
+
+}
+
+#endif
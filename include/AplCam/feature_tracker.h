@@ -46,6 +46,8 @@ namespace AplCam {
 
       FeatureTracker( void );
 
+      // img may be 8-bit gray, or gray already scaled to [0,1] as
+      // CV_32FC1, which saves each track converting its own search area
       void update( Mat &img, vector< KeyPoint > &kps, Mat &drawTo, float scale = 1.0 );
 
       void drawTracks( Mat &img, float scale = 1.0 ) { drawTracks( _tracks, img, scale ); }
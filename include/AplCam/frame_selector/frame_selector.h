@@ -6,6 +6,8 @@
 #include <opencv2/core/core.hpp>
 #include <opencv2/features2d/features2d.hpp>
 
+#include "AplCam/prepared_frame.h"
+
 namespace AplCam {
 
   using cv::Mat;
@@ -16,6 +18,14 @@ namespace AplCam {
       virtual ~FrameSelector( void ) {;}
 
       virtual bool process( Mat &img ) = 0;
+
+      // As process(), for selectors which can use the frame's cached
+      // derived images
+      virtual bool select( PreparedFrame &frame )
+      {
+        Mat img( frame.image() );
+        return process( img );
+      }
   };
 
   class AllFrameSelector : public FrameSelector {
@@ -43,17 +53,50 @@ namespace AplCam {
 
   };
 
+  // Selects a new keyframe once the view has moved far enough from the
+  // last one.  FAST corners found in the keyframe are followed from frame
+  // to frame with pyramidal Lucas-Kanade flow;  a frame becomes the next
+  // keyframe when too few of those corners survive (overlap) or they have
+  // moved too far, as a fraction of the image diagonal (parallax).
+  //
+  // All work is done on a gray copy downscaled to workingWidth, which keeps
+  // the per-frame cost to a few ms regardless of the video resolution.
   class KeyframeSelector : public FrameSelector {
     public:
 
-      KeyframeSelector( void );
+      struct Params {
+        Params( void )
+          : workingWidth( 480 ), fastThreshold( 20 ), maxFeatures( 400 ),
+            minFeatures( 20 ), minOverlap( 0.5 ), maxParallax( 0.1 )
+        {;}
+
+        int workingWidth, fastThreshold, maxFeatures, minFeatures;
+        float minOverlap, maxParallax;
+      };
+
+      KeyframeSelector( const Params &params = Params() );
 
       virtual bool process( Mat &img );
+      virtual bool select( PreparedFrame &frame );
+
+      // Statistics for the most recent frame
+      float overlap( void ) const  { return _overlap; }
+      float parallax( void ) const { return _parallax; }
 
     protected:
 
-      std::vector<cv::KeyPoint> _kfKeyPoints;
+      void toWorking( PreparedFrame &frame, Mat &gray ) const;
+      void setKeyframe( const Mat &gray );
+
+      Params _params;
+
+      Mat _prevGray;
+
+      // Corresponding positions in the keyframe and in the previous frame
+      std::vector< cv::Point2f > _kfPoints, _trackedPoints;
+      size_t _kfCount;
 
+      float _overlap, _parallax;
   };
 
 }
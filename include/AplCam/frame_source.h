@@ -3,10 +3,16 @@
 
 #include <vector>
 #include <string>
+#include <deque>
+#include <future>
+#include <atomic>
+#include <memory>
 
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
 
+#include "AplCam/work_queue.h"
+
 using std::vector;
 using std::string;
 using cv::Mat;
@@ -16,6 +22,7 @@ namespace AplCam {
   class FrameSource {
     public:
       FrameSource() {;}
+      virtual ~FrameSource() {;}
 
       virtual bool isOpened( void ) const { return true; };
       virtual bool read( Mat & ) = 0;
@@ -40,6 +47,13 @@ namespace AplCam {
         return false;
       }
 
+      // File the last frame was read from
+      const string &filename( void ) const
+      {
+        static const string none;
+        return (_idx > 0 && _idx <= _imgFiles.size()) ? _imgFiles[ _idx-1 ] : none;
+      }
+
     protected:
 
       vector< string > _imgFiles;
@@ -48,6 +62,60 @@ namespace AplCam {
   };
 
 
+  // ListOfImages which decodes the next few images on a pool of threads
+  // while the caller works on the current one.  Frames are still returned
+  // in list order.
+  //
+  // When the consumer only needs detection input, images can be decoded
+  // straight to gray and/or at 1/2, 1/4 or 1/8 resolution, which with
+  // JPEG is much cheaper than decoding the full image and converting.
+  class PrefetchingListOfImages : public ListOfImages {
+    public:
+
+      struct Options {
+        Options( void )
+          : prefetch( 0 ), numThreads( 0 ), grayscale( false ), reduce( 1 )
+        {;}
+
+        // Images decoded ahead of the caller;  <= 0 is one per thread
+        int prefetch;
+        // <= 0 uses the number of hardware threads
+        int numThreads;
+
+        bool grayscale;
+        // 1, 2, 4 or 8
+        int reduce;
+      };
+
+      PrefetchingListOfImages( const vector< string > &imgFiles, const Options &opts = Options() );
+      virtual ~PrefetchingListOfImages();
+
+      virtual bool read( Mat &img );
+
+      // As read(), and also returns the image's file name
+      bool read( Mat &img, string &filename );
+
+      const Options &options( void ) const { return _opts; }
+
+      // The decode used for each image, also useful to callers who want
+      // to match it with a plain imread()
+      static Mat Load( const string &filename, bool grayscale, int reduce );
+
+    protected:
+
+      void fill( void );
+
+      Options _opts;
+      size_t _next;
+
+      // Set on destruction so queued decodes are skipped
+      std::atomic< bool > _cancelled;
+
+      std::unique_ptr< WorkerPool > _pool;
+      std::deque< std::future< Mat > > _pending;
+  };
+
+
   class VideoSource : public FrameSource {
     public:
 
@@ -10,11 +10,25 @@ using cv::Mat;
 
 typedef std::vector< cv::Vec3d > Circles_t;
 
+// Drop-in for cv::HoughCircles( ..., CV_HOUGH_GRADIENT, ... ):  param1 is
+// the upper Canny threshold, param2 the accumulator threshold.  Only
+// radii in [min_radius, max_radius] are voted for, so a tight range is
+// much cheaper than the default (max_radius <= 0: the image size).
+//
+// Circles are returned strongest first, with sub-cell centers.
 void HoughCircles( Mat &src_image, Circles_t &output,
                   int method, double dp, double min_dist,
                   double param1, double param2,
                   int min_radius, int max_radius );
 
+// As above, searching only within roi;  circles are still returned in
+// full-image coordinates.
+void HoughCircles( Mat &src_image, Circles_t &output,
+                  int method, double dp, double min_dist,
+                  double param1, double param2,
+                  int min_radius, int max_radius,
+                  const cv::Rect &roi );
+
 }
 
 #endif
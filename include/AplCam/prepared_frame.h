@@ -0,0 +1,98 @@
+#ifndef __APLCAM_PREPARED_FRAME_H__
+#define __APLCAM_PREPARED_FRAME_H__
+
+#include <deque>
+
+#include <opencv2/core/core.hpp>
+
+#include "AplCam/distortion/undistort_downscaler.h"
+
+namespace AplCam {
+
+  using cv::Mat;
+  using cv::Size;
+
+  // One video frame plus the images derived from it.  Each derived image
+  // is computed the first time it's asked for and memoized, so the
+  // detectors, trackers and selectors handed the same PreparedFrame share
+  // one grayscale conversion, one pyramid, etc.
+  //
+  // Not thread safe;  use one PreparedFrame per thread, or prepare what's
+  // needed before handing it to parallel code.
+  class PreparedFrame {
+    public:
+
+      PreparedFrame( const Mat &img );
+
+      const Mat &image( void ) const { return _image; }
+
+      // CV_8UC1.  The original image if it is already gray
+      const Mat &gray( void );
+
+      // gray() scaled to [0,1] as CV_32FC1
+      const Mat &grayFloat( void );
+
+      // Gaussian pyramid of gray();  level 0 is gray() itself
+      const Mat &pyramid( int level );
+
+      // Integral image of gray(), CV_32S (CV_64F if the sum could
+      // overflow), one larger in each dimension
+      const Mat &integral( void );
+
+      // GaussianBlur of gray()
+      const Mat &blurred( const Size &ksize, double sigma );
+
+      // CLAHE of gray().  The CLAHE object itself is reused across frames.
+      const Mat &equalized( double clipLimit = 40, const Size &tiles = Size(4,4) );
+
+      // Gray image undistorted and downscaled by the frame's
+      // UndistortDownscaler, in one pass over image().  Points found in
+      // it are undistorted;  normalize them with undistorter()->cameraMatrix().
+      // Empty if no undistorter has been set.
+      const Mat &undistortedGray( void );
+
+      void setUndistorter( const cv::Ptr<Distortion::UndistortDownscaler> &undistorter )
+      { _undistorter = undistorter;  _undistortedGray.release(); }
+
+      const cv::Ptr<Distortion::UndistortDownscaler> &undistorter( void ) const
+      { return _undistorter; }
+
+      // Requests answered from the cache / requiring a computation
+      unsigned int hits( void ) const   { return _hits; }
+      unsigned int misses( void ) const { return _misses; }
+
+    protected:
+
+      struct Blurred {
+        Size ksize;
+        double sigma;
+        Mat img;
+      };
+
+      struct Equalized {
+        double clipLimit;
+        Size tiles;
+        Mat img;
+      };
+
+      bool hit( bool cached )
+      {
+        if( cached ) ++_hits; else ++_misses;
+        return cached;
+      }
+
+      Mat _image;
+
+      Mat _gray, _grayFloat, _integral, _undistortedGray;
+      cv::Ptr<Distortion::UndistortDownscaler> _undistorter;
+      // deques, so references handed out stay valid as entries are added
+      std::deque< Mat > _pyramid;
+      std::deque< Blurred > _blurred;
+      std::deque< Equalized > _equalized;
+
+      unsigned int _hits, _misses;
+  };
+
+}
+
+#endif
@@ -2,13 +2,53 @@
 #ifndef __APLCAM_RANDOM_H__
 #define __APLCAM_RANDOM_H__
 
+#include <time.h>
+
 #include <random>
+#include <vector>
 
 namespace AplCam {
 
+  // Shared, not thread-safe.  Prefer a per-instance generator.
   static std::minstd_rand0 _rand = std::minstd_rand0( time(NULL) );
   inline unsigned long unaryRandom( int i ) { return _rand() % i; }
 
+  // Uniform random sample of up to "capacity" items from a stream of
+  // unknown length, in one pass and O(capacity) memory (Algorithm R).
+  // Each instance owns its generator, so independent samplers can run
+  // concurrently.
+  template< typename T >
+  class Reservoir {
+    public:
+      Reservoir( size_t capacity, unsigned long seed )
+        : _capacity( capacity ), _seen( 0 ), _rng( seed )
+      { _items.reserve( capacity ); }
+
+      void add( const T &item )
+      {
+        ++_seen;
+
+        if( _items.size() < _capacity ) {
+          _items.push_back( item );
+        } else if( _capacity > 0 ) {
+          // Keep with probability capacity/seen
+          std::uniform_int_distribution< unsigned long > dist( 0, _seen-1 );
+          const unsigned long j = dist( _rng );
+          if( j < _capacity ) _items[j] = item;
+        }
+      }
+
+      size_t seen( void ) const { return _seen; }
+      const std::vector< T > &items( void ) const { return _items; }
+
+    protected:
+
+      size_t _capacity;
+      unsigned long _seen;
+      std::mt19937 _rng;
+      std::vector< T > _items;
+  };
+
 }
 
 #endif
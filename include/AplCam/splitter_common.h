@@ -8,6 +8,7 @@
 
 #include <iostream>
 #include <iomanip>
+#include <memory>
 
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
@@ -18,9 +19,17 @@
 #include "AplCam/file_utils.h"
 
 #include "AplCam/frame_source.h"
+#include "AplCam/prepared_frame.h"
+
+#include "AplCam/board/board.h"
+#include "AplCam/board_tracker.h"
 
 #include "AplCam/frame_selector/frame_selector.h"
 
+#include "AplCam/distortion/undistort_downscaler.h"
+
+#include "AplCam/async_writer.h"
+
 using namespace std;
 using namespace cv;
 
@@ -38,7 +47,11 @@ namespace AplCam {
         _doSaveFrames( false ),
         _doSaveVideo( false ),
         fps(1),
-        fpsSet( false )
+        fpsSet( false ),
+        writeThreads( 0 ),
+        writeQueue( 16 ),
+        undistortCamera(),
+        boardFile()
     {;}
 
       //typedef enum {EXTRACT_SINGLE, EXTRACT_INTERVAL,  NONE = -1} Verbs;
@@ -53,6 +66,17 @@ namespace AplCam {
       float fps;
       bool fpsSet;
 
+      // Output stage;  writeThreads <= 0 uses all hardware threads
+      int writeThreads, writeQueue;
+
+      // If set, camera calibration used to undistort, downscale and gray
+      // the display and detection images in one pass
+      string undistortCamera;
+
+      // If set, this board is detected (with a BoardTracker) in every
+      // split frame and drawn on the display
+      string boardFile;
+
       bool parseArgs( int argc, char **argv, stringstream &msg );
       virtual void doParse( TCLAP::CmdLine &cmd, int argc, char **argv );
 
@@ -82,12 +106,37 @@ namespace AplCam {
       virtual bool processRejectedFrame( Mat &img, Mat &toDisplay )
       { return true; }
 
+      // Called by run();  override these to share the frame's cached
+      // gray, pyramid, etc. with the selector.  By default calls the Mat
+      // version, then detects the board (if any) on the same frame.
+      virtual bool processSplitFrame( PreparedFrame &frame, Mat &toDisplay );
+
+      virtual bool processRejectedFrame( PreparedFrame &frame, Mat &toDisplay )
+      { Mat img( frame.image() ); return processRejectedFrame( img, toDisplay ); }
+
+      // If set, frames to be displayed are undistorted, downscaled and
+      // converted to gray in one pass rather than resized, and each
+      // PreparedFrame offers the result as undistortedGray().  run()
+      // builds one from SplitterOpts::undistortCamera if none is set.
+      void setUndistorter( const Ptr<Distortion::UndistortDownscaler> &undistorter )
+      { _undistorter = undistorter; }
+
     protected:
 
+      bool makeUndistorter( const Size &imgSize );
+
+      Ptr<Distortion::UndistortDownscaler> _undistorter;
+
+      // From SplitterOpts::boardFile
+      std::unique_ptr< Board > _board;
+      std::unique_ptr< BoardTracker > _tracker;
+      unsigned int _boardFrames;
+
       Ptr<FrameSelector> _selector;
       int _frame;
 
-      VideoWriter _videoWriter;
+      // Frames and video are encoded off the read/select loop
+      Ptr<AsyncFrameWriter> _writer;
 
     private:
 
@@ -6,6 +6,12 @@
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
 
+#include "AplCam/composite_canvas.h"
+
+namespace Distortion {
+  class DistortionModel;
+}
+
 namespace AplCam {
 
   using cv::Mat;
@@ -37,16 +43,32 @@ namespace AplCam {
       bool isInitialized( void ) const
           { return !( R[0].empty() || R[1].empty() || P[0].empty() || P[1].empty() || Q.empty()); }
 
+      // Precomputed undistort/rectify maps (CV_16SC2 + CV_16UC1, as
+      // used by cv::remap) for each camera.  Built once by initMaps();
+      // saved and loaded with the rest of the rectification.
+      bool hasMaps( void ) const
+          { return !( map1[0].empty() || map2[0].empty() || map1[1].empty() || map2[1].empty() ); }
+
+      void initMaps( Distortion::DistortionModel &cam0, Distortion::DistortionModel &cam1,
+                     const cv::Size &imageSize );
+
+      // Rectifies both halves of a synchronized pair in place, in
+      // parallel.  Requires hasMaps()
+      void rectify( CompositeCanvas &canvas ) const;
+
       void save( cv::FileStorage &fs ) const ;
 
       bool load( cv::FileStorage &fs );
       bool load( const std::string &filename );
 
       Mat R[2], P[2], Q;
+      Mat map1[2], map2[2];
 
       static const std::string rect0Tag, rect1Tag,
                                proj0Tag, proj1Tag,
-                                qTag;
+                                qTag,
+                                map1_0Tag, map1_1Tag,
+                                map2_0Tag, map2_1Tag;
   };
 
 }
@@ -0,0 +1,118 @@
+#ifndef __APLCAM_SYNTHETIC_CORPUS_H__
+#define __APLCAM_SYNTHETIC_CORPUS_H__
+
+#include <string>
+#include <vector>
+#include <random>
+
+#include <opencv2/core/core.hpp>
+
+#include "AplCam/board/board.h"
+#include "AplCam/detection/detection.h"
+
+namespace AplCam {
+
+  using std::string;
+  using std::vector;
+  using cv::Mat;
+  using cv::Size;
+
+  // Renders a reproducible set of synthetic chessboard images with known
+  // intrinsics, poses and corner locations, as a fixed benchmark for the
+  // detection and calibration paths.
+  //
+  // Image i depends only on the seed and i (each has its own generator),
+  // so images may be rendered in any order, on any number of threads,
+  // and come out bit-identical.
+  //
+  // Boards are rendered by inverse mapping:  each pixel's undistorted ray
+  // is intersected with the board plane, and the chessboard pattern is
+  // integrated analytically over the pixel's footprint on the board, so
+  // edges are antialiased without supersampling.
+  class SyntheticCorpus {
+    public:
+
+      struct Params {
+        Params()
+          : imageSize( 1280, 960 ), focalLength( 0 ), distCoeffs(),
+            minFill( 0.3 ), maxFill( 0.8 ), maxTilt( 50 ),
+            noiseSigma( 2.0 ), seed( 1 )
+        {;}
+
+        Size imageSize;
+
+        // In pixels;  <= 0 uses the image width (about a 53 degree FOV)
+        double focalLength;
+
+        // OpenCV ordering (k1, k2, p1, p2[, k3]);  empty for none
+        vector< double > distCoeffs;
+
+        // Fraction of the image width covered by the board
+        double minFill, maxFill;
+
+        // Maximum angle between the board normal and the optical axis, degrees
+        double maxTilt;
+
+        // Gaussian pixel noise, in gray levels
+        double noiseSigma;
+
+        unsigned long seed;
+      };
+
+      // Ground truth for one image.  Corners are in the board's corner
+      // order (x fastest), id y*width+x, only those inside the image.
+      struct Frame {
+        Frame() : rvec(), tvec(), detection() {;}
+
+        cv::Vec3d rvec, tvec;
+        Detection detection;
+      };
+
+      // Only chessboards are supported.  board must outlive this.
+      SyntheticCorpus( const Board &board, const Params &params = Params() );
+
+      const Params &params( void ) const { return _params; }
+      Mat cameraMatrix( void ) const     { return Mat( _K ).clone(); }
+      Mat distCoeffs( void ) const       { return Mat( _params.distCoeffs, true ); }
+
+      // Renders image i into img (CV_8UC1 of imageSize).  Returns its
+      // ground truth.
+      Frame render( int i, Mat &img ) const;
+
+      // Renders count images in parallel.  Ground truth goes to a
+      // DetectionArchive at archiveFile, with frame numbers 0..count-1,
+      // and optionally (if non-empty) to groundTruthFile as YAML.  Images
+      // are written as imageDir/000000.png ... if imageDir is non-empty.
+      bool generate( int count, const string &archiveFile,
+                     const string &groundTruthFile = "", const string &imageDir = "" );
+
+      const vector< Frame > &frames( void ) const { return _frames; }
+
+      // Board coordinates are in squares:  the checkered area is
+      // [0, width+1] x [0, height+1], with the white border one square
+      // wide around it.
+      static const int BorderSquares = 1;
+
+    protected:
+
+      void samplePose( std::mt19937 &rng, cv::Vec3d &rvec, cv::Vec3d &tvec ) const;
+      bool boardVisible( const cv::Vec3d &rvec, const cv::Vec3d &tvec ) const;
+
+      void drawBoard( const cv::Vec3d &rvec, const cv::Vec3d &tvec,
+                      unsigned char background, Mat &img ) const;
+
+      bool writeGroundTruth( const string &filename ) const;
+
+      const Board &_board;
+      Params _params;
+      cv::Matx33d _K;
+
+      // Undistorted, normalized ray for the center of every pixel (CV_32FC2)
+      Mat _rays;
+
+      vector< Frame > _frames;
+  };
+
+}
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef __APLCAM_WORK_QUEUE_H__
+#define __APLCAM_WORK_QUEUE_H__
+
+#include <algorithm>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+namespace AplCam {
+
+  // Fixed-capacity FIFO shared between threads.  push() blocks while the
+  // queue is full, which is how a slow consumer throttles its producer.
+  // Once close()d, push() fails and pop() drains what's left, then fails.
+  template< typename T >
+  class BoundedQueue {
+    public:
+      BoundedQueue( size_t capacity )
+        : _capacity( capacity > 0 ? capacity : 1 ), _closed( false )
+      {;}
+
+      bool push( const T &item )
+      {
+        std::unique_lock< std::mutex > lock( _mutex );
+        _notFull.wait( lock, [this]{ return _closed || _queue.size() < _capacity; } );
+        if( _closed ) return false;
+
+        _queue.push_back( item );
+        _notEmpty.notify_one();
+        return true;
+      }
+
+      bool pop( T &item )
+      {
+        std::unique_lock< std::mutex > lock( _mutex );
+        _notEmpty.wait( lock, [this]{ return _closed || !_queue.empty(); } );
+        if( _queue.empty() ) return false;
+
+        item = _queue.front();
+        _queue.pop_front();
+        _notFull.notify_one();
+        return true;
+      }
+
+      void close( void )
+      {
+        std::lock_guard< std::mutex > lock( _mutex );
+        _closed = true;
+        _notFull.notify_all();
+        _notEmpty.notify_all();
+      }
+
+      size_t size( void ) const
+      {
+        std::lock_guard< std::mutex > lock( _mutex );
+        return _queue.size();
+      }
+
+      size_t capacity( void ) const { return _capacity; }
+
+    protected:
+
+      size_t _capacity;
+      bool _closed;
+      std::deque< T > _queue;
+
+      mutable std::mutex _mutex;
+      std::condition_variable _notFull, _notEmpty;
+  };
+
+
+  // A fixed set of threads running jobs from a BoundedQueue.
+  class WorkerPool {
+    public:
+      typedef std::function< void(void) > Job;
+
+      // numThreads <= 0 uses the number of hardware threads
+      WorkerPool( int numThreads, size_t queueDepth )
+        : _jobs( queueDepth )
+      {
+        if( numThreads <= 0 ) numThreads = std::max( 1u, std::thread::hardware_concurrency() );
+
+        for( int i = 0; i < numThreads; ++i )
+          _threads.push_back( std::thread( &WorkerPool::work, this ) );
+      }
+
+      ~WorkerPool()
+      { join(); }
+
+      // Blocks while the queue is full
+      bool submit( const Job &job )
+      { return _jobs.push( job ); }
+
+      // Finish all queued jobs and stop the threads
+      void join( void )
+      {
+        _jobs.close();
+        for( size_t i = 0; i < _threads.size(); ++i )
+          if( _threads[i].joinable() ) _threads[i].join();
+      }
+
+      size_t numThreads( void ) const { return _threads.size(); }
+      size_t queued( void ) const     { return _jobs.size(); }
+
+    protected:
+
+      void work( void )
+      {
+        Job job;
+        while( _jobs.pop( job ) ) job();
+      }
+
+      BoundedQueue< Job > _jobs;
+      std::vector< std::thread > _threads;
+
+    private:
+
+      WorkerPool( const WorkerPool & );
+      WorkerPool &operator=( const WorkerPool & );
+  };
+
+}
+
+#endif
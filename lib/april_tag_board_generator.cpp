@@ -4,6 +4,8 @@
 
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
+#include <unordered_map>
 
 #include <AprilTags/TagFamily.h>
 #include <AprilTags/Tag16h5.h>
@@ -26,6 +28,10 @@ AprilTagBoard::AprilTagBoard( const AprilTags::TagCodes &tagCode,
 {
   cv::randu( _tags, 0, _tagFamily.codes().size() );
 
+  for( int i = 0; i < arraySize().width; ++i )
+    for( int j = 0; j < arraySize().height; ++j )
+      _idPositions[ codeIdAt(i,j) ].push_back( Point2i(i,j) );
+
   cout << endl;
   for(   int j = 0; j < arraySize().height; ++j ) {
     for( int i = 0; i < arraySize().width;  ++i )
@@ -60,11 +66,7 @@ AprilTags::Code_t AprilTagBoard::codeAt( int i, int j ) const
 
 bool AprilTagBoard::hasId( unsigned int id ) const
 {
-  for( int i = 0; i < arraySize().width; ++i )
-    for( int j = 0; j < arraySize().height; ++j )
-    if( codeIdAt(i,j) == id ) return true;
-
-  return false;
+  return _idPositions.count( id ) > 0;
 }
 
 Point3f AprilTagBoard::locationAt( int x, int y ) const
@@ -75,71 +77,98 @@ Point3f AprilTagBoard::locationAt( int x, int y ) const
 
 bool AprilTagBoard::idLocation( unsigned int id, Point3f &pt ) const
 {
-  for( int i = 0; i < arraySize().width; ++i )
-    for( int j = 0; j < arraySize().height; ++j )
-      if( codeIdAt(i,j) == id ) {
-        pt = locationAt( i, j );
-        return true;
-      }
+  auto itr = _idPositions.find( id );
+  if( itr == _idPositions.end() ) return false;
 
-  return false;
+  pt = locationAt( itr->second.front().x, itr->second.front().y );
+  return true;
 }
 
+// Total Hamming distance between the detected ids and the board codes
+// where they overlap, with board position = ids position + offset
 int AprilTagBoard::calculateDistance( const Mat &ids, const Point2i &offset )
 {
-  int maxWidth = std::max( ids.cols, _tags.cols ),
-      maxHeight = std::max( ids.rows, _tags.rows );
+  Rect overlap( Rect( Point2i(0,0), _tags.size() ) & Rect( offset, ids.size() ) );
 
   int distance = 0;
+  for( int y = overlap.y; y < overlap.y + overlap.height; ++y ) {
+    for( int x = overlap.x; x < overlap.x + overlap.width; ++x ) {
+      const int16_t id = ids.at<int16_t>( y - offset.y, x - offset.x );
+      if( id < 0 || id >= (int)_tagFamily.codes().size() ) continue;
 
-  Rect tagsRect( Point2i(0,0), _tags.size() ),
-       idsRect( offset, ids.size() );
-
-  // Inefficient procedure but works for now
-  for( int x = -maxWidth; x < maxWidth; ++x ) {
-    for( int y = -maxHeight; y < maxHeight; ++y ) {
-
-      Point2i pt = Point2i(x,y);
-      if( !(tagsRect.contains(pt) && idsRect.contains(pt)) ) continue;
-
-      Point2i idsIdx = pt - offset;
-      if( ids.at<int16_t>(idsIdx.y, idsIdx.x) < 0 ) continue;
-
-      distance += _tagFamily.hammingDistance( _tagFamily.codes()[ ids.at<int16_t>(idsIdx.y, idsIdx.x) ], codeAt(x,y) );
-
+      distance += _tagFamily.hammingDistance( _tagFamily.codes()[ id ], codeAt(x,y) );
     }
   }
 
   return distance;
 }
 
+// Offsets keyed into a single integer for hashing
+static inline int64_t offsetKey( const Point2i &offset )
+{ return ((int64_t)offset.y << 32) ^ (uint32_t)offset.x; }
+
+// Strict order on offsets:  smaller shift first, then (y,x)
+static inline bool closerOffset( const Point2i &a, const Point2i &b )
+{
+  const int na = a.dot(a), nb = b.dot(b);
+  if( na != nb ) return na < nb;
+  return a.y < b.y || (a.y == b.y && a.x < b.x);
+}
+
 Mat AprilTagBoard::mostLikelyAlignment( const Mat &ids, Mat &valid )
 {
   Mat positions( Mat::zeros( ids.size(), CV_32FC3 ) );
   valid = Mat::zeros( ids.size(), CV_8U );
 
-  // Start by determining the alignment between ids and _tags.
-  map< int , pair< Point2i, int > > results;
+  // Start by determining the alignment between ids and _tags.  Every
+  // detected id votes for each offset which would put it on a board
+  // position with the same id;  the true alignment collects a vote from
+  // every correctly decoded tag.
+  std::unordered_map< int64_t, pair< Point2i, int > > votes;
 
   // Insert rotation here
-  int maxshift = 1;
-  for( int x = -maxshift; x < maxshift+1; ++x ) {
-    for( int y = -maxshift; y < maxshift+1; ++y ) {
-      Point2i offset(x,y);
-
-      int distance = calculateDistance( ids, offset );
-
-      //cout << "For offset " << offset.x << ',' << offset.y << ", distance = " << distance << endl;
-      if( distance >= 0 ) results[distance] = make_pair( offset, 0 );
+  for( int y = 0; y < ids.rows; ++y ) {
+    for( int x = 0; x < ids.cols; ++x ) {
+      const int16_t id = ids.at<int16_t>(y,x);
+      if( id < 0 ) continue;
+
+      auto itr = _idPositions.find( id );
+      if( itr == _idPositions.end() ) continue;
+
+      for( size_t k = 0; k < itr->second.size(); ++k ) {
+        const Point2i offset( itr->second[k] - Point2i(x,y) );
+        pair< Point2i, int > &vote( votes[ offsetKey( offset ) ] );
+        vote.first = offset;
+        ++vote.second;
+      }
     }
   }
 
-  if( results.size() == 0 ) return Mat();
-
-  Point2i bestOffset( results.begin()->second.first );
-  int bestRotation = results.begin()->second.second;
+  if( votes.size() == 0 ) return Mat();
+
+  // Most votes wins;  ties go to the smaller Hamming distance over the overlap,
+  // which is only computed for offsets sharing the top count.  Any tie
+  // left goes to the smallest shift, then the smallest (y,x), so the
+  // result doesn't depend on the hash table's iteration order.
+  int bestVotes = 0;
+  for( auto itr = votes.begin(); itr != votes.end(); ++itr )
+    bestVotes = std::max( bestVotes, itr->second.second );
+
+  Point2i bestOffset;
+  int bestDistance = -1;
+  for( auto itr = votes.begin(); itr != votes.end(); ++itr ) {
+    if( itr->second.second != bestVotes ) continue;
+
+    const Point2i &offset( itr->second.first );
+    const int distance = calculateDistance( ids, offset );
+    if( bestDistance < 0 || distance < bestDistance ||
+        (distance == bestDistance && closerOffset( offset, bestOffset )) ) {
+      bestOffset = offset;
+      bestDistance = distance;
+    }
+  }
 
-  cout << "Best offset: " << bestOffset.x << ',' << bestOffset.y << endl;
+  cout << "Best offset: " << bestOffset.x << ',' << bestOffset.y << " (" << bestVotes << " votes)" << endl;
 
   // Then use that to assign a position to member of ids.
 
@@ -147,11 +176,11 @@ Mat AprilTagBoard::mostLikelyAlignment( const Mat &ids, Mat &valid )
 
   for( int x = 0; x < ids.cols; ++x ) {
     for( int y = 0; y < ids.rows; ++y ) {
-      Point2i idx( x - bestOffset.x, y - bestOffset.y );
+      Point2i idx( x + bestOffset.x, y + bestOffset.y );
 
       if( tagsRect.contains( idx ) ) {
         valid.at<uint8_t>(y,x) = 1;
-        positions.at<Point3f>(y,x) = locationAt( x, y );
+        positions.at<Point3f>(y,x) = locationAt( idx.x, idx.y );
       }
     }
   }
@@ -3,8 +3,9 @@
 #include <iomanip>
 #include <fstream>
 
-#include <list>
-#include <map>
+#include <algorithm>
+#include <deque>
+#include <unordered_map>
 
 // AprilTags currently uses Eigen for fixed-size vectors and matrices
 #include <Eigen/Core>
@@ -18,8 +19,8 @@ using namespace cv;
 using namespace std;
 
 
-  AprilTagDetectionSet::AprilTagDetectionSet( const vector<TagDetection> detections )
-: _detections( detections ), _grid()
+AprilTagDetectionSet::AprilTagDetectionSet( const vector<TagDetection> detections )
+: _detections( detections ), _grid(), _ids(), _gridCount( 0 )
 {
   arrangeIntoGrid();
 }
@@ -32,44 +33,11 @@ using namespace std;
 
 
 
-
-
-cv::Mat AprilTagDetectionSet::gridOfIds( void )
-{
-  Mat ids( _grid.size(), CV_16S );
-
-  for( int i = 0; i < _grid.rows; ++i )
-    for( int j = 0; j < _grid.cols; ++j )  {
-      int idx = _grid.at<int16_t>(i,j);
-      ids.at<int16_t>(i,j) = (idx >= 0) ?  _detections[ _grid.at<int16_t>(i,j) ].id : -1;
-    }
-
-  return ids;
-}
-
-
-int AprilTagDetectionSet::gridCount( void ) const
-{
-  int count = 0;
-  for( int y = 0; y < _grid.rows; ++y )
-    for( int x = 0; x < _grid.cols; ++x )
-      if( indexAt(x,y) >= 0 ) ++count;
-
-  return count;
-}
-
-
-
 //============================================================================
 //
 //
 //============================================================================
 
-bool CompareAlongTrack( const pair< double, int > &a, const pair< double, int> &b  )
-{
-  return (a.first < b.first);
-}
-
 struct Gaussian
 {
   public:
@@ -82,95 +50,150 @@ struct Gaussian
     float mean, sigma;
 };
 
-static const float cosLimit = cos( 15 * M_PI / 180.0 );
-int nearestNode( const vector< Vector2d > &centers, const Vector2d &vector )
-{
-  map< double, int > candidates;
+// Uniform grid over tag centers in the image.  Cells are about one tag
+// across, so the tags near a given tag are found by visiting a handful
+// of cells rather than every other tag.
+class TagCenterIndex {
+  public:
+    TagCenterIndex( const vector<TagDetection> &detections, double cellSize )
+      : _cell( std::max( cellSize, 1.0 ) )
+    {
+      if( detections.empty() ) { _cols = _rows = 0; return; }
+
+      double x1 = detections[0].cxy.first, y1 = detections[0].cxy.second;
+      _x0 = x1;  _y0 = y1;
+      for( size_t i = 1; i < detections.size(); ++i ) {
+        _x0 = std::min( _x0, (double)detections[i].cxy.first );
+        _y0 = std::min( _y0, (double)detections[i].cxy.second );
+        x1 = std::max( x1, (double)detections[i].cxy.first );
+        y1 = std::max( y1, (double)detections[i].cxy.second );
+      }
 
-  for( unsigned int i = 0; i < centers.size(); ++i ) {
-    if( centers[i].hasNaN() ) continue;
+      _cols = (int)((x1 - _x0) / _cell) + 1;
+      _rows = (int)((y1 - _y0) / _cell) + 1;
 
-    double along = vector.dot( centers[i] );
-    double cos = along / (vector.norm() * centers[i].norm() );
+      // Counting sort of tags into cells
+      vector< int > cellOf( detections.size() );
+      _start.assign( _cols * _rows + 1, 0 );
+      for( size_t i = 0; i < detections.size(); ++i ) {
+        cellOf[i] = cellIndex( detections[i].cxy.first, detections[i].cxy.second );
+        ++_start[ cellOf[i] + 1 ];
+      }
+      for( size_t c = 1; c < _start.size(); ++c ) _start[c] += _start[c-1];
 
-    //cout << "To " << centers[i].second->detection.id << " is " << along << " cos " << cos << endl;
+      _members.resize( detections.size() );
+      vector< int > fill( _start.begin(), _start.end() - 1 );
+      for( size_t i = 0; i < detections.size(); ++i )
+        _members[ fill[ cellOf[i] ]++ ] = i;
+    }
 
-    if( (cos > cosLimit ) and (along > 0) )
-      candidates[ along ] = i;
+    // Indices of all tags in cells within radius of (x,y).  May include
+    // tags slightly further away;  callers filter as needed.
+    void near( double x, double y, double radius, vector< int > &out ) const
+    {
+      out.clear();
+      if( _cols == 0 ) return;
+
+      const int cx0 = std::max( 0, (int)floor( (x - radius - _x0) / _cell ) ),
+                cx1 = std::min( _cols-1, (int)floor( (x + radius - _x0) / _cell ) ),
+                cy0 = std::max( 0, (int)floor( (y - radius - _y0) / _cell ) ),
+                cy1 = std::min( _rows-1, (int)floor( (y + radius - _y0) / _cell ) );
+
+      for( int cy = cy0; cy <= cy1; ++cy )
+        for( int cx = cx0; cx <= cx1; ++cx ) {
+          const int c = cy * _cols + cx;
+          out.insert( out.end(), _members.begin() + _start[c], _members.begin() + _start[c+1] );
+        }
+    }
 
-  }
+  protected:
 
-  if( candidates.size() == 0 ) return -1;
+    int cellIndex( double x, double y ) const
+    {
+      return std::min( _rows-1, (int)((y - _y0) / _cell) ) * _cols +
+             std::min( _cols-1, (int)((x - _x0) / _cell) );
+    }
 
-  // Want the closest
-  return candidates.begin()->second;
-}
+    double _cell, _x0, _y0;
+    int _cols, _rows;
 
-int mostLikelyNode( const vector< Vector2d > &centers, const Gaussian &gaussian, const Vector2d &vector )
-{
-  map< double, int > candidates;
+    // Tags in cell c are _members[ _start[c] .. _start[c+1] )
+    vector< int > _start, _members;
+};
 
-  for( unsigned int i = 0; i < centers.size(); ++i ) {
-    if( centers[i].hasNaN() ) continue;
+// Another tag's center, in the frame of the tag it neighbours
+struct Neighbour {
+  Neighbour( int i, const Vector2d &c )
+    : idx( i ), center( c ), norm( c.norm() ) {;}
 
-    double along = vector.dot( centers[i] );
-    double cos = along / (vector.norm() * centers[i].norm() );
+  int idx;
+  Vector2d center;
+  double norm;
+};
 
-    //cout << "To " << centers[i].second->detection.id << " is " << along << " cos " << cos << endl;
+// Neighbours are searched for within this many tag widths
+static const double NeighbourRadius = 4.0;
 
-    float prob = gaussian.p(along);
-    if( (cos > cosLimit ) and (along > 0) and (prob > 0.99) )
-      candidates[ prob ] = i;
+static const float cosLimit = cos( 15 * M_PI / 180.0 );
 
-  }
+// Closest neighbour within 15 degrees of direction (a unit vector)
+static int nearestNode( const vector< Neighbour > &neighbours, const Vector2d &direction )
+{
+  int best = -1;
+  double bestAlong = 0;
 
-  if( candidates.size() == 0 ) return -1;
+  for( size_t i = 0; i < neighbours.size(); ++i ) {
+    const double along = direction.dot( neighbours[i].center );
+    if( along <= 0 || along <= cosLimit * neighbours[i].norm ) continue;
 
-  // Want the largest probability
-  return candidates.rbegin()->second;
+    if( best < 0 || along < bestAlong ) {
+      best = i;
+      bestAlong = along;
+    }
+  }
+
+  return best;
 }
 
-void AprilTagDetectionSet::assignToGraph( const vector<DetectionNode> &nodes, const int idx, Mat &graph, const int x, const int y, int *limits )
+// Most probable neighbour within 15 degrees of direction, given the
+// distribution of neighbour spacings
+static int mostLikelyNode( const vector< Neighbour > &neighbours, const Gaussian &gaussian, const Vector2d &direction )
 {
-  //assert( graph.at<int16_t>(y,x) == -1 || graph.at<int16_t>(y,x) == node->detection.id );
-
-  if( graph.at<int16_t>(y,x) != -1 ) return;
-  if( y < 0 || x < 0 || y >= graph.rows || x >= graph.cols ) return;
-  if( idx < 0 || idx >= _detections.size() ) return;
+  int best = -1;
+  double bestProb = 0;
 
-  //cout << "Assign " << node->detection.id << endl;
+  for( size_t i = 0; i < neighbours.size(); ++i ) {
+    const double along = direction.dot( neighbours[i].center );
+    if( along <= 0 || along <= cosLimit * neighbours[i].norm ) continue;
 
-  graph.at<int16_t>(y,x) = idx;
-
-  limits[0] = std::min( x, limits[0] );
-  limits[1] = std::max( x, limits[1] );
-  limits[2] = std::min( y, limits[2] );
-  limits[3] = std::max( y, limits[3] );
+    const float prob = gaussian.p( along );
+    if( prob > 0.99 && (best < 0 || prob >= bestProb) ) {
+      best = i;
+      bestProb = prob;
+    }
+  }
 
-  if( nodes[idx].left > 0 ) assignToGraph( nodes, nodes[idx].left, graph, x-1, y, limits );
-  if( nodes[idx].right > 0 ) assignToGraph( nodes, nodes[idx].right, graph, x+1, y, limits );
-  if( nodes[idx].up > 0 )   assignToGraph( nodes, nodes[idx].up, graph, x, y+1, limits );
-  if( nodes[idx].down > 0 ) assignToGraph( nodes, nodes[idx].down, graph, x, y-1, limits );
+  return best;
 }
 
-Gaussian estimateCenterSpacing( list<double> &values )
+Gaussian estimateCenterSpacing( vector<double> &values )
 {
   if( values.size() > 10 ) {
     // For robustness drop the largest and the smallest.
-    values.sort();
-    values.pop_front();
-    values.pop_back();
+    std::sort( values.begin(), values.end() );
+    values.erase( values.end() - 1 );
+    values.erase( values.begin() );
   }
 
   // Assume inliers >> outliers for now
 
-  double mean, var;
+  double mean = 0, var = 0;
 
-  for( list<double>::iterator itr = values.begin(); itr != values.end(); ++itr ) mean += (*itr);
+  for( size_t i = 0; i < values.size(); ++i ) mean += values[i];
   mean /= values.size();
 
   // Calculate sample variance
-  for( list<double>::iterator itr = values.begin(); itr != values.end(); ++itr ) var += ( (*itr) - mean )*( (*itr) - mean );
+  for( size_t i = 0; i < values.size(); ++i ) var += ( values[i] - mean )*( values[i] - mean );
   var /= (values.size() - 1);
 
   return Gaussian( mean, var );
@@ -178,136 +201,109 @@ Gaussian estimateCenterSpacing( list<double> &values )
 
 void AprilTagDetectionSet::arrangeIntoGrid( void )
 {
-  // Identify the four corners of the
-  vector< DetectionNode > nodes( _detections.size() );
+  const size_t n = _detections.size();
+  if( n < 2 ) return;
 
-  // Try to identify the distribution of distances to adjacent tags
-  list< double > lrSpacing, udSpacing;
+  // Tag widths in the image, which set the index cell size and the
+  // per-tag search radius
+  vector< double > widths( n );
+  for( size_t i = 0; i < n; ++i ) widths[i] = sqrt( std::max( 1.0f, _detections[i].totalArea() ) );
+
+  vector< double > sorted( widths );
+  std::nth_element( sorted.begin(), sorted.begin() + n/2, sorted.end() );
+  TagCenterIndex index( _detections, sorted[n/2] );
 
-  for( unsigned int current = 0; current < _detections.size(); ++current ) {
+  // Each tag's neighbours, expressed in its own frame (via its homography)
+  vector< vector< Neighbour > > neighbours( n );
+  vector< int > candidates;
 
-    Matrix3d invHom( _detections[current].homography.inverse() );
-    vector< Vector2d  > centers( _detections.size() );
+  for( size_t current = 0; current < n; ++current ) {
+    const TagDetection &det( _detections[current] );
+    Matrix3d invHom( det.homography.inverse() );
 
-    centers[current] = Vector2d(NAN,NAN);
+    index.near( det.cxy.first, det.cxy.second, NeighbourRadius * widths[current], candidates );
 
-    for( unsigned int other = 0; other < _detections.size(); ++other ) {
-      if( other == current ) continue;
+    for( size_t k = 0; k < candidates.size(); ++k ) {
+      const int other = candidates[k];
+      if( other == (int)current ) continue;
 
       Vector3d warped( invHom *
-          Vector3d( _detections[other].cxy.first - _detections[current].hxy.first,
-            _detections[other].cxy.second - _detections[current].hxy.second, 1.0 ) );
+          Vector3d( _detections[other].cxy.first - det.hxy.first,
+            _detections[other].cxy.second - det.hxy.second, 1.0 ) );
 
-      Vector2d c( warped.x() / warped.z(), warped.y() / warped.z() );
+      neighbours[current].push_back( Neighbour( other, Vector2d( warped.x() / warped.z(), warped.y() / warped.z() ) ) );
+    }
+  }
 
-      //cout << "Relative to " << nodes[current]->detection.id << " the center of " << nodes[other]->detection.id << " is at " << c.x() << "   " << c.y() << endl;
+  // Try to identify the distribution of distances to adjacent tags
+  vector< double > lrSpacing, udSpacing;
+  lrSpacing.reserve( 2*n );  udSpacing.reserve( 2*n );
 
-      centers[other] = c;
-    }
+  for( size_t current = 0; current < n; ++current ) {
+    const vector< Neighbour > &nb( neighbours[current] );
 
-    int right = nearestNode( centers, Vector2d( 1, 0 ) );
-    if( right >= 0 ) lrSpacing.push_back( centers[right].norm() );
+    int right = nearestNode( nb, Vector2d( 1, 0 ) );
+    if( right >= 0 ) lrSpacing.push_back( nb[right].norm );
 
-    int left = nearestNode( centers, Vector2d( 1, 0 ) );
-    if( left >= 0 ) lrSpacing.push_back( centers[left].norm() );
+    int left = nearestNode( nb, Vector2d( -1, 0 ) );
+    if( left >= 0 ) lrSpacing.push_back( nb[left].norm );
 
-    int up = nearestNode( centers, Vector2d( 1, 0 ) );
-    if( up >= 0 ) udSpacing.push_back( centers[up].norm() );
+    int up = nearestNode( nb, Vector2d( 0, 1 ) );
+    if( up >= 0 ) udSpacing.push_back( nb[up].norm );
 
-    int down = nearestNode( centers, Vector2d( 1, 0 ) );
-    if( down >= 0 ) udSpacing.push_back( centers[down].norm() );
+    int down = nearestNode( nb, Vector2d( 0, -1 ) );
+    if( down >= 0 ) udSpacing.push_back( nb[down].norm );
+  }
 
+  if( lrSpacing.size() < 2 || udSpacing.size() < 2 ) {
+    cout << "Not enough adjacent tags to estimate spacing.  Giving up" << endl;
+    return;
   }
 
   Gaussian lrGaussian = estimateCenterSpacing( lrSpacing );
-  cout << "LR spacing has mean " << lrGaussian.mean << " sigma " << lrGaussian.sigma << endl;
   Gaussian udGaussian = estimateCenterSpacing( udSpacing );
-  cout << "UD spacing has mean " << udGaussian.mean << " sigma " << udGaussian.sigma << endl;
 
+  vector< DetectionNode > nodes( n );
 
-  for( unsigned int current = 0; current < _detections.size(); ++current ) {
-
-    Matrix3d invHom( _detections[current].homography.inverse() );
-    vector< Vector2d  > centers( _detections.size() );
-
-    centers[current] = Vector2d(NAN,NAN);
-
-    for( unsigned int other = 0; other < _detections.size(); ++other ) {
-      if( other == current ) continue;
-
-      Vector3d warped( invHom *
-          Vector3d( _detections[other].cxy.first - _detections[current].hxy.first,
-            _detections[other].cxy.second - _detections[current].hxy.second, 1.0 ) );
-
-      Vector2d c( warped.x() / warped.z(), warped.y() / warped.z() );
-
-      //cout << "Relative to " << nodes[current]->detection.id << " the center of " << nodes[other]->detection.id << " is at " << c.x() << "   " << c.y() << endl;
-
-      centers[other] = c;
-    }
+  for( size_t current = 0; current < n; ++current ) {
+    const vector< Neighbour > &nb( neighbours[current] );
 
     if( nodes[current].right < 0 ) {
-      //cout << "Evaluate right " << endl;
-      int nearest = mostLikelyNode( centers, lrGaussian, Vector2d( 1, 0 ) );
+      int nearest = mostLikelyNode( nb, lrGaussian, Vector2d( 1, 0 ) );
       if( nearest >= 0 ) {
-        //cout << "Right of " << _detections[current].id << " is " << _detections[nearest].id << endl;
-        nodes[current].right = nearest;
-        nodes[nearest].left = current;
+        nodes[current].right = nb[nearest].idx;
+        nodes[ nb[nearest].idx ].left = current;
       }
     }
 
     if( nodes[current].left < 0 ) {
-      int nearest = mostLikelyNode( centers, lrGaussian, Vector2d( -1, 0 ) );
+      int nearest = mostLikelyNode( nb, lrGaussian, Vector2d( -1, 0 ) );
       if( nearest >= 0 ) {
-        //cout << "Left of " << _detections[current].id << " is " << _detections[nearest].id << endl;
-        nodes[current].left = nearest;
-        nodes[nearest].right = current;
+        nodes[current].left = nb[nearest].idx;
+        nodes[ nb[nearest].idx ].right = current;
       }
     }
 
     if( nodes[current].up < 0 ) {
-      int nearest = mostLikelyNode( centers, udGaussian, Vector2d( 0, 1 ) );
+      int nearest = mostLikelyNode( nb, udGaussian, Vector2d( 0, 1 ) );
       if( nearest >= 0 ) {
-        //cout << "Up of " << _detections[current].id << " is " << _detections[nearest].id << endl;
-        nodes[current].up = nearest;
-        nodes[nearest].down = current;
+        nodes[current].up = nb[nearest].idx;
+        nodes[ nb[nearest].idx ].down = current;
       }
     }
 
     if( nodes[current].down < 0 ) {
-      int nearest = mostLikelyNode( centers, udGaussian, Vector2d( 0, -1 ) );
+      int nearest = mostLikelyNode( nb, udGaussian, Vector2d( 0, -1 ) );
       if( nearest >= 0 ) {
-        //cout << "Down of " << _detections[current].id << " is " << _detections[nearest].id << endl;
-        nodes[current].down = nearest;
-        nodes[nearest].up = current;
+        nodes[current].down = nb[nearest].idx;
+        nodes[ nb[nearest].idx ].up = current;
       }
     }
   }
 
-  // Dump the graph to DOT to examine it
-  ofstream dot("/tmp/graph.dot");
-
-  dot << "graph april {" << endl;
-  for( unsigned int i = 0; i < _detections.size(); ++i ) {
-    dot << i << " [label=\"" << _detections[i].id << "\"]" << endl;
-    if( nodes[i].right >= 0 ) dot << i << "--" << nodes[i].right << endl;
-    if( nodes[i].left >= 0 ) dot << i << "--" << nodes[i].left << endl;
-    if( nodes[i].up >= 0 ) dot << i << "--" << nodes[i].up << endl;
-    if( nodes[i].down >= 0 ) dot << i << "--" << nodes[i].down << endl;
-  }
-  dot << "}" << endl;
-
-  // Now convert it to an Matrix of values.
-  Mat graph( Size(2 * _detections.size(), 2* _detections.size()), CV_16S );
-  graph.setTo( -1 );
-  int x = _detections.size(), y = _detections.size();
-
-  int limits[4] = { x,x,y,y };
-
   // Try to seed the graph with a well-connected individual.
-  vector< int > connections(4);
-  for( int i = 0; i < 4; ++i ) connections[i] = -1;
-  for( unsigned int i = 0; i < _detections.size(); ++i ) {
+  vector< int > connections(5, -1);
+  for( size_t i = 0; i < n; ++i ) {
     int neighbors = 0;
     if( nodes[i].right >= 0 ) neighbors++;
     if( nodes[i].left >= 0 ) neighbors++;
@@ -324,22 +320,70 @@ void AprilTagDetectionSet::arrangeIntoGrid( void )
   if( use == -1 ) use = connections[2];
   if( use == -1 ) { cout << "Tag graph is pathological.  Giving up" << endl; return; }
 
-  assignToGraph( nodes, use, graph, x, y, limits );
+  assignToGrid( nodes, use );
+}
+
+void AprilTagDetectionSet::assignToGrid( const vector<DetectionNode> &nodes, const int seed )
+{
+  // Breadth-first walk of the neighbour graph, giving each tag a grid
+  // position relative to the seed.  The first tag to claim a position
+  // keeps it.
+  const int n = _detections.size();
+  vector< Point > pos( n );
+  vector< bool > placed( n, false );
+  std::unordered_map< int64_t, int > occupied;
+
+  const auto key = []( int x, int y ) { return ((int64_t)y << 32) ^ (uint32_t)x; };
 
-  //cout << limits[0] << ' ' << limits[1] << ' ' << limits[2] << ' ' << limits[3] << endl;
-  // Find the bounding box of non-(-1) values
-  Rect rect( limits[0], limits[2], limits[1]-limits[0]+1, limits[3]-limits[2]+1 );
-  Mat roi( graph, rect );
+  std::deque< int > queue;
+  pos[seed] = Point( 0, 0 );
+  placed[seed] = true;
+  occupied[ key(0,0) ] = seed;
+  queue.push_back( seed );
 
-  _grid.create( roi.size(), roi.type() );
+  int minX = 0, maxX = 0, minY = 0, maxY = 0;
 
-  // Can't figure out my axis problem that lead to this needing to be flipped...
-  cv::flip( roi, _grid, 1 );
+  while( !queue.empty() ) {
+    const int idx = queue.front();
+    queue.pop_front();
 
-  //cout << _grid << endl;
+    const int next[4] = { nodes[idx].left, nodes[idx].right, nodes[idx].up, nodes[idx].down };
+    const Point step[4] = { Point(-1,0), Point(1,0), Point(0,1), Point(0,-1) };
 
-  cout <<  "Identified IDs: " << endl << gridOfIds() << endl;
+    for( int k = 0; k < 4; ++k ) {
+      const int other = next[k];
+      if( other < 0 || other >= n || placed[other] ) continue;
 
+      const Point p( pos[idx] + step[k] );
+      if( occupied.count( key( p.x, p.y ) ) ) continue;
+
+      pos[other] = p;
+      placed[other] = true;
+      occupied[ key( p.x, p.y ) ] = other;
+      queue.push_back( other );
+
+      minX = std::min( minX, p.x );  maxX = std::max( maxX, p.x );
+      minY = std::min( minY, p.y );  maxY = std::max( maxY, p.y );
+    }
+  }
+
+  const int cols = maxX - minX + 1, rows = maxY - minY + 1;
+  _grid.create( rows, cols, CV_16S );
+  _grid.setTo( -1 );
+  _ids.create( rows, cols, CV_16S );
+  _ids.setTo( -1 );
+  _gridCount = 0;
+
+  for( int i = 0; i < n; ++i ) {
+    if( !placed[i] ) continue;
+
+    // Can't figure out my axis problem that lead to this needing to be flipped...
+    const int x = cols - 1 - (pos[i].x - minX), y = pos[i].y - minY;
+
+    _grid.at<int16_t>( y, x ) = i;
+    _ids.at<int16_t>( y, x ) = _detections[i].id;
+    ++_gridCount;
+  }
 }
 
 
@@ -0,0 +1,142 @@
+
+#include <glog/logging.h>
+
+#include "AplCam/async_writer.h"
+
+namespace AplCam {
+
+  using namespace cv;
+
+  static double elapsedSec( int64 startTicks )
+  { return (getTickCount() - startTicks) / getTickFrequency(); }
+
+  AsyncFrameWriter::AsyncFrameWriter( int numThreads, size_t queueDepth )
+    : _imagePool( new WorkerPool( numThreads, queueDepth ) ),
+      _video(), _videoQueue(), _videoThread(),
+      _queueDepth( queueDepth ), _finished( false ),
+      _errors( 0 )
+  {;}
+
+  AsyncFrameWriter::~AsyncFrameWriter()
+  {
+    finish();
+  }
+
+  void AsyncFrameWriter::writeImage( const string &filename, const Mat &img )
+  {
+    CHECK( !_finished ) << "writeImage() called after finish()";
+
+    // Captured by value:  the job owns its copy of the pixels
+    Mat copy( img.clone() );
+
+    int64 start = getTickCount();
+    _imagePool->submit( [this, filename, copy]() {
+        int64 encStart = getTickCount();
+
+        if( !imwrite( filename, copy ) ) {
+          LOG(WARNING) << "Unable to write " << filename;
+          ++_errors;
+        }
+
+        double sec = elapsedSec( encStart );
+        std::lock_guard< std::mutex > lock( _statsMutex );
+        ++_imageStats.count;
+        _imageStats.busySec += sec;
+      } );
+
+    double blocked = elapsedSec( start );
+    std::lock_guard< std::mutex > lock( _statsMutex );
+    _imageStats.blockedSec += blocked;
+  }
+
+  bool AsyncFrameWriter::openVideo( const string &filename, int fourcc, double fps, const Size &sz )
+  {
+    CHECK( !_video ) << "Video already opened";
+
+    _video.reset( new VideoWriter( filename, fourcc, fps, sz ) );
+    if( !_video->isOpened() ) {
+      LOG(WARNING) << "Unable to open video " << filename << " for writing";
+      _video.reset();
+      return false;
+    }
+
+    _videoQueue.reset( new BoundedQueue< Mat >( _queueDepth ) );
+    _videoThread = std::thread( &AsyncFrameWriter::writeVideoFrames, this );
+
+    return true;
+  }
+
+  void AsyncFrameWriter::writeVideo( const Mat &img )
+  {
+    if( !_video || img.empty() ) return;
+
+    int64 start = getTickCount();
+    _videoQueue->push( img.clone() );
+
+    double blocked = elapsedSec( start );
+    std::lock_guard< std::mutex > lock( _statsMutex );
+    _videoStats.blockedSec += blocked;
+  }
+
+  void AsyncFrameWriter::writeVideoFrames( void )
+  {
+    Mat img;
+    while( _videoQueue->pop( img ) ) {
+      int64 start = getTickCount();
+      (*_video) << img;
+
+      double sec = elapsedSec( start );
+      std::lock_guard< std::mutex > lock( _statsMutex );
+      ++_videoStats.count;
+      _videoStats.busySec += sec;
+    }
+  }
+
+  void AsyncFrameWriter::finish( void )
+  {
+    if( _finished ) return;
+    _finished = true;
+
+    _imagePool->join();
+
+    if( _videoQueue ) {
+      _videoQueue->close();
+      if( _videoThread.joinable() ) _videoThread.join();
+
+      // Flushes and closes the container
+      _video->release();
+    }
+
+    if( _errors > 0 )
+      LOG(WARNING) << _errors << " images could not be written";
+  }
+
+  AsyncFrameWriter::Stats AsyncFrameWriter::imageStats( void ) const
+  {
+    std::lock_guard< std::mutex > lock( _statsMutex );
+    return _imageStats;
+  }
+
+  AsyncFrameWriter::Stats AsyncFrameWriter::videoStats( void ) const
+  {
+    std::lock_guard< std::mutex > lock( _statsMutex );
+    return _videoStats;
+  }
+
+  static void logStage( const string &name, const AsyncFrameWriter::Stats &stats, size_t threads )
+  {
+    if( stats.count == 0 ) return;
+
+    LOG(INFO) << name << ": " << stats.count << " frames on " << threads << " thread(s), "
+              << 1000 * stats.busySec / stats.count << " ms/frame encoding, "
+              << stats.count / std::max( 1e-6, stats.busySec / threads ) << " frames/s capacity, "
+              << stats.blockedSec << " s producer blocked on full queue";
+  }
+
+  void AsyncFrameWriter::logStats( void ) const
+  {
+    logStage( "Image writer", imageStats(), _imagePool->numThreads() );
+    logStage( "Video writer", videoStats(), 1 );
+  }
+
+}
@@ -15,6 +15,7 @@
 
 #include "AplCam/board/apriltags.h"
 #include "AplCam/detection/apriltags.h"
+#include "AplCam/prepared_frame.h"
 
 namespace AplCam {
 
@@ -53,35 +54,130 @@ namespace AplCam {
         _tagCode( AprilTags::tagCodes36h11 ),
         _subtagMinSize( doSubtags ? -1 : 100*100),
         _blackBorder( 1 ),
-        _tagSize( -1, -1 )
+        _tagSize( -1, -1 ),
+        _decimation( 1 )
   {
     ;
   }
 
   Detection *AprilTagsBoard::detectPattern( const cv::Mat &img )
   {
-    AprilTags::TagDetector tagDetector( _tagCode );
-
-    Mat gray;
-    ensureGrayscale( img, gray );
+    PreparedFrame frame( img );
+    return detect( frame );
+  }
 
-    vector<AprilTags::TagDetection> detections = tagDetector.extractTags(gray);
+  Detection *AprilTagsBoard::detect( PreparedFrame &frame )
+  {
+    const Mat &gray( frame.gray() );
+
+    vector<AprilTags::TagDetection> detections;
+    if( _decimation > 1 ) {
+      detections = extractDecimated( gray );
+    } else {
+      AprilTags::TagDetector tagDetector( _tagCode );
+      detections = tagDetector.extractTags(gray);
+    }
     LOG(INFO) << "Detected " << detections.size() << " AprilTags";
 
     if( _subtagMinSize > 0.0 ) {
 
-      Detection *detect = attemptSubtagDetection( gray, detections );
-      if( detect != NULL ) return detect;
+      Detection *subtags = attemptSubtagDetection( gray, detections );
+      if( subtags != NULL ) return subtags;
     }
 
     ObjectPointsVec worldLocations(detections.size());
     for( unsigned int i = 0; i < detections.size(); ++i ){
       worldLocations[i] = worldLocation( detections[i].id );
     }
-    AprilTagsDetection *detect = new AprilTagsDetection( detections, worldLocations );
-    return detect;
+    return new AprilTagsDetection( detections, worldLocations );
   }
 
+  vector<AprilTags::TagDetection> AprilTagsBoard::extractDecimated( const Mat &gray ) const
+  {
+    const double d = _decimation;
+
+    Mat small;
+    resize( gray, small, Size(), 1.0/d, 1.0/d, INTER_AREA );
+
+    AprilTags::TagDetector tagDetector( _tagCode );
+    vector<AprilTags::TagDetection> detections = tagDetector.extractTags( small );
+
+    // Pixel centers in the small image map to (x + 0.5) * d - 0.5
+    const double shift = 0.5 * (d - 1);
+    const int win = std::max( 3, (int)ceil( d ) + 1 );
+    const TermCriteria criteria( CV_TERMCRIT_EPS+CV_TERMCRIT_ITER, 20, 0.05 );
+
+    // Tag corners in the tag's own frame, in the order of p[]
+    const double tagCorners[4][2] = { {-1,-1}, {1,-1}, {1,1}, {-1,1} };
+
+    for( size_t i = 0; i < detections.size(); ++i ) {
+      AprilTags::TagDetection &tag( detections[i] );
+
+      vector< Point2f > corners( 4 );
+      for( int j = 0; j < 4; ++j )
+        corners[j] = Point2f( tag.p[j].first * d + shift, tag.p[j].second * d + shift );
+
+      // The outer corners of the black border are sharp corners in the
+      // full-resolution image
+      cornerSubPix( gray, corners, Size( win, win ), Size(-1,-1), criteria );
+
+      tag.hxy = std::make_pair( tag.hxy.first * d + shift, tag.hxy.second * d + shift );
+
+      // Rebuild the homography (tag frame to image, relative to hxy) from
+      // the refined corners
+      vector< Point2f > src( 4 ), dst( 4 );
+      for( int j = 0; j < 4; ++j ) {
+        tag.p[j] = std::make_pair( corners[j].x, corners[j].y );
+        src[j] = Point2f( tagCorners[j][0], tagCorners[j][1] );
+        dst[j] = Point2f( corners[j].x - tag.hxy.first, corners[j].y - tag.hxy.second );
+      }
+
+      Mat H( getPerspectiveTransform( src, dst ) );
+      for( int r = 0; r < 3; ++r )
+        for( int c = 0; c < 3; ++c )
+          tag.homography( r, c ) = H.at<double>( r, c );
+
+      // Center is the image of the tag origin
+      tag.cxy = std::make_pair( H.at<double>(0,2) / H.at<double>(2,2) + tag.hxy.first,
+                                H.at<double>(1,2) / H.at<double>(2,2) + tag.hxy.second );
+    }
+
+    return detections;
+  }
+
+  // Substructure of each large-enough tag, one tag per task
+  struct SubtagBody : public ParallelLoopBody {
+    SubtagBody( const Mat &gray, const vector<AprilTags::TagDetection> &detections,
+                const vector< size_t > &todo, vector< vector<AprilTags::CornerDetection> > &corners )
+      : _gray( gray ), _detections( detections ), _todo( todo ), _corners( corners )
+    {;}
+
+    const Mat &_gray;
+    const vector<AprilTags::TagDetection> &_detections;
+    const vector< size_t > &_todo;
+    vector< vector<AprilTags::CornerDetection> > &_corners;
+
+    virtual void operator()( const Range &r ) const
+    {
+      // The detector holds per-detection state, so one per thread
+      SubtagDetector subtag( AprilTags::tagCodes36h11 );
+      subtag.setSigma( 1.5 );
+
+      for( int i = r.start; i < r.end; ++i )
+        _corners[i] = subtag.detectTagSubstructure( _gray, _detections[ _todo[i] ] );
+    }
+  };
+
+  struct TagIdLess {
+    TagIdLess( const vector<AprilTags::TagDetection> &detections )
+      : _detections( detections ) {;}
+    const vector<AprilTags::TagDetection> &_detections;
+
+    bool operator()( size_t a, size_t b ) const
+    { return _detections[a].id < _detections[b].id ||
+             (_detections[a].id == _detections[b].id && a < b ); }
+  };
+
   Detection *AprilTagsBoard::attemptSubtagDetection( const Mat &gray, vector<AprilTags::TagDetection> &detections )
   {
     if( _tagSize.width < 0.0 ) {
@@ -89,40 +185,39 @@ namespace AplCam {
       return NULL;
     }
 
-    SubtagDetector subtag( AprilTags::tagCodes36h11 );
-    subtag.saveDebugImages( true );
-    subtag.setSigma( 1.5 );
-    //vector<AprilTags::SubtagDetection> subtagDetections;
-
-    Detection *out = new Detection;
-    int id = 0;
-
+    // Tags large enough for subtag detection, in id order so the
+    // output doesn't depend on detection order
+    vector< size_t > todo;
     for( unsigned int i = 0; i < detections.size(); ++i ){
       float area = detections[i].totalArea();
 
       bool doSubtag = (area >= _subtagMinSize);
       LOG(INFO) << "Tag area of " << area << " pixels, " << (doSubtag ? "attempting" : "skipping") << " subtag detection";
 
-      if( !doSubtag ) continue;
+      if( doSubtag ) todo.push_back( i );
+    }
+    std::sort( todo.begin(), todo.end(), TagIdLess( detections ) );
+
+    vector< vector<AprilTags::CornerDetection> > tagCorners( todo.size() );
+    parallel_for_( Range( 0, todo.size() ), SubtagBody( gray, detections, todo, tagCorners ) );
 
-      vector<AprilTags::CornerDetection> corners( subtag.detectTagSubstructure( gray, detections[i] ));
+    Detection *out = new Detection;
+    int id = 0;
 
-      ObjectPoint tagCenter( worldLocation( detections[i].id ));
+    for( size_t t = 0; t < todo.size(); ++t ) {
+      const vector<AprilTags::CornerDetection> &corners( tagCorners[t] );
+      ObjectPoint tagCenter( worldLocation( detections[ todo[t] ].id ));
 
       for( unsigned int i = 0; i < corners.size(); ++i ) {
 
         // Position of corner in bit units from the center of the tag
-        Point2f pt( corners[i].inTag );
         ObjectPoint onBoard( corners[i].inTag.x * _tagSize.width/2.0,
                              corners[i].inTag.y * _tagSize.height/2.0,
                              0.0);
         onBoard += tagCenter;
 
-        // LOG(INFO) << "Point at " << corners[i].inTag.x << "," << corners[i].inTag.y << " a point " << pt << " world " << onBoard;
-
         out->add( onBoard, ImagePoint( corners[i].inImage), id++ );
       }
-
     }
 
     // Mat annotated( drawAnnotatedSubtags( gray, out ) );
@@ -13,29 +13,32 @@
 #include "AplCam/board/trailer_hitch.h"
 
 #include "AplCam/detection/detection.h"
+#include "AplCam/prepared_frame.h"
 
 namespace AplCam {
 
   using namespace std;
   using namespace cv;
 
+  const float Board::MinDecimatedSquare = 12;
+
   Detection *Board::detectPattern( const Mat &gray )
   {
-    Detection *detect = new Detection();
+    Detection *detect = NULL;
 
     switch( pattern )
     {
       case CHESSBOARD:
-        findChessboardCorners( gray, size(), detect->points,
-                                              CV_CALIB_CB_ADAPTIVE_THRESH | CV_CALIB_CB_FAST_CHECK | CV_CALIB_CB_NORMALIZE_IMAGE);
-
-        if( detect->good() ) cornerSubPix( gray, detect->points, Size(11,11), Size(-1,-1), TermCriteria( CV_TERMCRIT_EPS+CV_TERMCRIT_ITER, 30, 0.1 ));
-
-        break;
+        {
+          PreparedFrame frame( gray );
+          return detectChessboard( frame );
+        }
       case CIRCLES_GRID:
+        detect = new Detection();
         findCirclesGrid( gray, size(), detect->points );
         break;
       case ASYMMETRIC_CIRCLES_GRID:
+        detect = new Detection();
         findCirclesGrid( gray, size(), detect->points, CALIB_CB_ASYMMETRIC_GRID );
         break;
       default:
@@ -47,6 +50,89 @@ namespace AplCam {
     return detect;
   }
 
+  Detection *Board::detect( PreparedFrame &frame )
+  {
+    if( pattern == CHESSBOARD ) return detectChessboard( frame );
+
+    return detectPattern( frame.image() );
+  }
+
+  int Board::chessboardDecimation( const cv::Size &imgSize ) const
+  {
+    float squarePx = _lastSquarePx;
+    if( squarePx <= 0 ) squarePx = _expectedSquarePx;
+
+    // Without a hint, assume the board fills at least a third of the
+    // shorter image dimension
+    if( squarePx <= 0 )
+      squarePx = std::min( imgSize.width, imgSize.height ) / (3.0 * (std::max( width, height ) + 1));
+
+    int levels = 0;
+    while( levels < _maxDecimation &&
+           squarePx / (2 << levels) >= MinDecimatedSquare &&
+           std::min( imgSize.width, imgSize.height ) / (2 << levels) >= 240 )
+      ++levels;
+
+    return levels;
+  }
+
+  // Mean distance between horizontally adjacent corners
+  static float meanSquareSize( const ImagePointsVec &points, int width, int height )
+  {
+    double sum = 0;
+    int n = 0;
+    for( int y = 0; y < height; ++y )
+      for( int x = 1; x < width; ++x, ++n )
+        sum += norm( points[ y*width + x ] - points[ y*width + x - 1 ] );
+
+    return (n > 0) ? sum / n : -1;
+  }
+
+  Detection *Board::detectChessboard( PreparedFrame &frame )
+  {
+    const int flags = CV_CALIB_CB_ADAPTIVE_THRESH | CV_CALIB_CB_FAST_CHECK | CV_CALIB_CB_NORMALIZE_IMAGE;
+    const TermCriteria criteria( CV_TERMCRIT_EPS+CV_TERMCRIT_ITER, 30, 0.1 );
+
+    const Mat &gray( frame.gray() );
+
+    Detection *detect = new Detection();
+
+    const int levels = chessboardDecimation( gray.size() );
+    bool found = false;
+
+    if( levels > 0 ) {
+      const Mat &small( frame.pyramid( levels ) );
+      found = findChessboardCorners( small, size(), detect->points, flags );
+
+      if( found ) {
+        // pyrDown keeps every second sample, so level-l pixel x sits
+        // over full-resolution pixel x * 2^l
+        const float scale = 1 << levels;
+        for( size_t i = 0; i < detect->points.size(); ++i )
+          detect->points[i] = detect->points[i] * scale;
+
+        // Search window must cover the decimation error but stay
+        // within a square
+        const float squarePx = meanSquareSize( detect->points, width, height );
+        const int win = std::max( 5, std::min( (int)scale + 3, (int)(0.4 * squarePx) ) );
+        cornerSubPix( gray, detect->points, Size( win, win ), Size(-1,-1), criteria );
+      } else {
+        detect->points.clear();
+      }
+    }
+
+    if( !found ) {
+      found = findChessboardCorners( gray, size(), detect->points, flags );
+      if( detect->good() ) cornerSubPix( gray, detect->points, Size(11,11), Size(-1,-1), criteria );
+    }
+
+    // Remember the square size for choosing the next decimation.  This
+    // is why a Board mustn't be shared between threads.
+    _lastSquarePx = found ? meanSquareSize( detect->points, width, height ) : -1;
+
+    return detect;
+  }
+
   void Board::ensureGrayscale( const Mat &img, Mat &gray )
   {
 
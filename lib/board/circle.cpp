@@ -7,6 +7,8 @@
 
 #include "AplCam/board/circle.h"
 #include "AplCam/detection/circle.h"
+#include "AplCam/hough_circles.h"
+#include "AplCam/prepared_frame.h"
 
 namespace AplCam {
 using namespace std;
@@ -18,129 +20,181 @@ using namespace cv;
 
 void CircleBoard::loadCallback( FileStorage &fs )
 {
+  if( !fs["min_radius"].empty() ) fs["min_radius"] >> _minRadius;
+  if( !fs["max_radius"].empty() ) fs["max_radius"] >> _maxRadius;
 }
 
 Detection *CircleBoard::detectPattern( const cv::Mat &img )
 {
-  Mat gray;
-  ensureGrayscale( img, gray );
+  PreparedFrame frame( img );
+  return detect( frame );
+}
 
+Detection *CircleBoard::detect( PreparedFrame &frame )
+{
   // Gaussian blur
-  Mat blurred;
-  cv::GaussianBlur( gray, blurred, Size(5,5), 0,0 );
+  Mat blurred( frame.blurred( Size(5,5), 0 ) );
 
-  vector<Vec3f> circles;
+  Circles_t found;
   const float accumRes = 2, minDist = 4;
-  cv::HoughCircles( blurred, circles, CV_HOUGH_GRADIENT, accumRes, minDist, 100, 100 );
+  const Rect roi( _searchRegion.area() > 0 ? _searchRegion : Rect( 0, 0, blurred.cols, blurred.rows ) );
+  AplCam::HoughCircles( blurred, found, CV_HOUGH_GRADIENT, accumRes, minDist, 100, 100,
+                        _minRadius, _maxRadius, roi );
 
+  vector<Vec3f> circles( found.begin(), found.end() );
   return new CircleDetection( circles );
 }
 
 
 
 //===========================================================================
-//  ColorSegmentationCircleBoard
+//  HueWeighting
 //===========================================================================
 
-void ColorSegmentationCircleBoard::loadCallback( FileStorage &fs )
+HueWeighting::HueWeighting( float hueDeg )
+    : _hueDeg( hueDeg ),
+      _hueLut( 1, 256, CV_8UC1, Scalar(0) ),
+      _squareLut( 1, 256, CV_16UC1 )
 {
+  // 8-bit hue is degrees/2;  entries past 179 never occur
+  for( int h = 0; h < 180; ++h )
+    _hueLut.at<uchar>(h) = saturate_cast<uchar>( 255 * 0.5 * (1 + cos( (2*h - hueDeg) * M_PI/180.0 )) );
+
+  for( int i = 0; i < 256; ++i )
+    _squareLut.at<ushort>(i) = i * i;
 }
 
-Detection *ColorSegmentationCircleBoard::detectPattern( const cv::Mat &img )
+float HueWeighting::HueOf( const cv::Scalar &bgr )
 {
-  // Desired color in BGR
-  Scalar targetColor( 0, 128, 255 );
-  Vec3f  targetColorF( targetColor[0]/256, targetColor[1]/256, targetColor[2]/256 );
-
-  const string hWindow = "channel0 - H",
-        sWindow = "channel1 - S",
-        vWindow = "channel2 - V";
-  const string diffWindow = "diff";
-  const string enhancedWindow = "enhanced";
-
-  //  namedWindow( hWindow );
-  //  namedWindow( sWindow );
-  //  namedWindow( vWindow );
-
-  namedWindow( diffWindow );
-  namedWindow(enhancedWindow);
-
-  // Compute hue value for target color
-  float B = targetColorF[0], G = targetColorF[1], R = targetColorF[2];
+  float B = bgr[0], G = bgr[1], R = bgr[2];
   float alpha = 0.5 * ( 2* R - B - G );
   float beta = 0.86603 * ( G - B );    // Constant is sqrt(3)/2
-  float targetAng = atan2( beta, alpha );
 
-  //Scalar targetCS( cos( ang ), sin( ang ) );
+  float deg = atan2( beta, alpha ) * 180.0 / M_PI;
+  return (deg < 0) ? deg + 360 : deg;
+}
 
-  Mat imgF, hsv;
-  img.convertTo( imgF, CV_32FC3, 1.0/255 );
-  cvtColor( imgF, hsv, CV_BGR2HSV );
+void HueWeighting::apply( const cv::Mat &hsv, cv::Mat &weight ) const
+{
+  CV_Assert( hsv.type() == CV_8UC3 );
 
   vector<Mat> channels;
   split( hsv, channels );
 
-  //  imshow( hWindow, channels[0] / 360.0 );
-  //  imshow( sWindow, channels[1] );
-  //  imshow( vWindow, channels[2] );
+  // Products of 8-bit fractions, rescaled back to 8 bits;  the square
+  // is kept to 16
+  Mat w;
+  LUT( channels[0], _hueLut, w );
+  multiply( w, channels[1], w, 1.0/255 );
+  multiply( w, channels[2], w, 1.0/255 );
 
+  LUT( w, _squareLut, weight );
+}
 
-  Mat diff( channels[0].size(), CV_32FC1 );
-  assert( diff.type() == CV_32FC1 &&
-      channels[0].type() == CV_32FC1 &&
-      channels[1].type() == CV_32FC1 &&
-      channels[2].type() == CV_32FC1 );
+// Row bands of ApplyAll().  Each band is split once;  s*v is shared by
+// all targets.
+struct ApplyAllHueBody : public ParallelLoopBody {
+  ApplyAllHueBody( const Mat &hsv, const vector< Mat > &hueLuts, const Mat &squareLut,
+                   vector<Mat> &weights )
+      : _hsv( hsv ), _hueLuts( hueLuts ), _squareLut( squareLut ), _weights( weights )
+  {;}
+
+  const Mat &_hsv;
+  const vector< Mat > &_hueLuts;
+  const Mat &_squareLut;
+  vector<Mat> &_weights;
+
+  virtual void operator()( const Range &r ) const
+  {
+    vector<Mat> channels;
+    split( _hsv.rowRange( r.start, r.end ), channels );
+
+    Mat sv, w;
+    multiply( channels[1], channels[2], sv, 1.0/255 );
+
+    for( size_t t = 0; t < _hueLuts.size(); ++t ) {
+      LUT( channels[0], _hueLuts[t], w );
+      multiply( w, sv, w, 1.0/255 );
+
+      Mat out( _weights[t].rowRange( r.start, r.end ) );
+      LUT( w, _squareLut, out );
+    }
+  }
+};
 
-  float *d = (float *)diff.data,
-        *h = (float *)channels[0].data,
-        *s = (float *)channels[1].data,
-        *v = (float *)channels[2].data;
+void HueWeighting::ApplyAll( const cv::Mat &hsv, const std::vector< const HueWeighting * > &weightings,
+                             std::vector< cv::Mat > &weights )
+{
+  CV_Assert( hsv.type() == CV_8UC3 );
 
-  for( int i = 0; i < (diff.rows * diff.cols); i++ )  {
-    d[i] = (cos( (h[i] * M_PI/180.0) - targetAng ) + 1) * 0.5;
-    d[i] *= s[i] * v[i];
-    d[i] = powf( d[i], 2 );
+  weights.resize( weightings.size() );
+  vector< Mat > hueLuts( weightings.size() );
+  for( size_t i = 0; i < weightings.size(); ++i ) {
+    weights[i].create( hsv.size(), CV_16UC1 );
+    hueLuts[i] = weightings[i]->_hueLut;
   }
 
-  // Normalize diff so max(diff) = 1
-  double mn, mx;
-  minMaxLoc( diff, &mn, &mx );
-  diff *= 1.0/mx;
+  if( weightings.empty() ) return;
 
-  imshow( diffWindow, diff );
+  // The square table doesn't depend on the hue
+  parallel_for_( Range( 0, hsv.rows ),
+                 ApplyAllHueBody( hsv, hueLuts, weightings[0]->_squareLut, weights ) );
+}
 
-  Mat diffBlur;
-  dilate( diff, diff, Mat() );
-  GaussianBlur( diff, diffBlur, Size(7,7), 3, 3  );
 
-  // V = diff
-  // S = 1 - diff
-  diffBlur.copyTo( channels[2] );
-  subtract( Scalar(1), diffBlur, channels[1] );
+//===========================================================================
+//  ColorSegmentationCircleBoard
+//===========================================================================
 
-//  Mat enhanced, enhancedBGR;
-//  merge( channels, enhanced );
-//  cvtColor( enhanced, enhancedBGR, CV_HSV2BGR );
-//
-//  imshow(enhancedWindow, enhancedBGR );
+ColorSegmentationCircleBoard::ColorSegmentationCircleBoard( const std::string &name )
+    : CircleBoard( COLOR_SEG_CIRCLE, name ),
+      _weighting( HueWeighting::HueOf( Scalar( 0, 128, 255 ) ) ),   // Orange
+      _debugDir()
+{;}
 
-  Mat gray;
-  diff.convertTo( gray, CV_8UC1, 255 );
+void ColorSegmentationCircleBoard::loadCallback( FileStorage &fs )
+{
+}
 
-  const string grayWindow = "gray";
-  namedWindow( grayWindow );
-  imshow( grayWindow, gray );
+Detection *ColorSegmentationCircleBoard::detectPattern( const cv::Mat &img )
+{
+  Mat hsv, weight;
+  cvtColor( img, hsv, CV_BGR2HSV );
+  _weighting.apply( hsv, weight );
+
+  return FindCircles( weight, _debugDir, name );
+}
+
+Detection *ColorSegmentationCircleBoard::detect( PreparedFrame &frame )
+{
+  return detectPattern( frame.image() );
+}
+
+Detection *ColorSegmentationCircleBoard::FindCircles( cv::Mat &weight,
+                                                      const std::string &debugDir, const std::string &tag )
+{
+  const bool debug = !debugDir.empty();
+
+  // Normalize so max(weight) = 255;  the 16-bit square keeps the low
+  // end until here
+  double mn, mx;
+  minMaxLoc( weight, &mn, &mx );
+  weight.convertTo( weight, CV_8U, (mx > 0) ? 255.0 / mx : 1.0 );
+
+  if( debug ) imwrite( debugDir + "/" + tag + "_weight.jpg", weight );
+
+  Mat gray;
+  dilate( weight, gray, Mat() );
 
   Mat blurred;
   GaussianBlur( gray, blurred, Size(9,9), 2,2 );
 
-  Mat canny;
-  cv::Canny( blurred, canny, 50, 100 );
-  const string cannyWindow = "canny";
-  namedWindow( cannyWindow );
-  canny *= 255;
-  imshow( cannyWindow, canny );
-
+  if( debug ) {
+    Mat canny;
+    cv::Canny( blurred, canny, 50, 100 );
+    imwrite( debugDir + "/" + tag + "_blurred.jpg", blurred );
+    imwrite( debugDir + "/" + tag + "_canny.jpg", canny );
+  }
 
   vector<Vec3f> circles;
   const float accumRes = 1, minDist = 4;
@@ -31,6 +31,8 @@ namespace AplCam {
    void TrailerHitch::from_json( const json &j ) {
      _targets.clear();
 
+     if( j.count("debug_dir") > 0 ) setDebugDirectory( j["debug_dir"].get<std::string>() );
+
      const json &targets( j["targets"] );
      for (json::const_iterator it = targets.begin(); it != targets.end(); ++it) {
 
@@ -45,111 +47,64 @@ namespace AplCam {
    }
 
 
-  Detection *TrailerHitch::detectPattern( const cv::Mat &img )
-  {
+  struct FindTargetCirclesBody : public ParallelLoopBody {
+    FindTargetCirclesBody( vector<Mat> &weights, const vector<string> &names,
+                           const string &debugDir, vector< CircleDetection * > &dets )
+      : _weights( weights ), _names( names ), _debugDir( debugDir ), _dets( dets )
+    {;}
 
-    LOG(INFO) << "Detect pattern!!";
+    vector<Mat> &_weights;
+    const vector<string> &_names;
+    const string &_debugDir;
+    vector< CircleDetection * > &_dets;
 
-    for( auto const &target : _targets ) {
-      auto det = target.detectPattern( img );
+    virtual void operator()( const Range &r ) const
+    {
+      for( int i = r.start; i < r.end; ++i )
+        _dets[i] = static_cast< CircleDetection * >(
+            ColorSegmentationCircleBoard::FindCircles( _weights[i], _debugDir, _names[i] ) );
     }
+  };
 
-    return nullptr;
-  }
-
-  Detection *TrailerHitch::HueTarget::detectPattern( const cv::Mat &img ) const
+  Detection *TrailerHitch::detectPattern( const cv::Mat &img )
   {
+    if( _targets.empty() ) return nullptr;
 
-    // Desired color in BGR
-    // Scalar targetColor( 0, 128, 255 );
-    // Vec3f  targetColorF( targetColor[0]/256, targetColor[1]/256, targetColor[2]/256 );
-
-    const string hWindow = "channel0 - H",
-          sWindow = "channel1 - S",
-          vWindow = "channel2 - V";
-    const string diffWindow = "diff";
-    const string enhancedWindow = "enhanced";
-
-    // Compute hue value for target color
-    // float B = targetColorF[0], G = targetColorF[1], R = targetColorF[2];
-    // float alpha = 0.5 * ( 2* R - B - G );
-    // float beta = 0.86603 * ( G - B );    // Constant is sqrt(3)/2
-    // float targetAng = atan2( beta, alpha );
-
-    //Scalar targetCS( cos( ang ), sin( ang ) );
-
-    Mat imgF, hsv;
-    img.convertTo( imgF, CV_32FC3, 1.0/255 );
-    cvtColor( imgF, hsv, CV_BGR2HSV );
-
-    vector<Mat> channels;
-    split( hsv, channels );
+    Mat hsv;
+    cvtColor( img, hsv, CV_BGR2HSV );
 
-    //  imshow( hWindow, channels[0] / 360.0 );
-    //  imshow( sWindow, channels[1] );
-    //  imshow( vWindow, channels[2] );
-
-
-    Mat diff( channels[0].size(), CV_32FC1 );
-    assert( diff.type() == CV_32FC1 &&
-        channels[0].type() == CV_32FC1 &&
-        channels[1].type() == CV_32FC1 &&
-        channels[2].type() == CV_32FC1 );
-
-    float *d = (float *)diff.data,
-          *h = (float *)channels[0].data,
-          *s = (float *)channels[1].data,
-          *v = (float *)channels[2].data;
-
-    for( int i = 0; i < (diff.rows * diff.cols); i++ )  {
-      d[i] = (cos( h[i] - _hue ) + 1) * 0.5;
-      d[i] *= s[i] * v[i];
-      d[i] = powf( d[i], 2 );
+    vector< const HueWeighting * > weightings;
+    vector< string > names;
+    for( auto const &target : _targets ) {
+      weightings.push_back( &target._weighting );
+      names.push_back( target.name );
     }
 
-    // Normalize diff so max(diff) = 1
-    double mn, mx;
-    minMaxLoc( diff, &mn, &mx );
-    diff *= 1.0/mx;
-
-    imwrite( "/tmp/diffHue.jpg", diff );
+    vector< Mat > weights;
+    HueWeighting::ApplyAll( hsv, weightings, weights );
 
-    Mat diffBlur;
-    dilate( diff, diff, Mat() );
-    GaussianBlur( diff, diffBlur, Size(7,7), 3, 3  );
+    vector< CircleDetection * > dets( _targets.size(), nullptr );
+    parallel_for_( Range( 0, _targets.size() ),
+                   FindTargetCirclesBody( weights, names, _debugDir, dets ) );
 
-    // V = diff
-    // S = 1 - diff
-    diffBlur.copyTo( channels[2] );
-    subtract( Scalar(1), diffBlur, channels[1] );
+    // HoughCircles returns circles in order of decreasing votes, so the
+    // first from each target is its best
+    vector< Vec3f > circles;
+    for( size_t i = 0; i < dets.size(); ++i )
+      circles.insert( circles.end(), dets[i]->_circles.begin(), dets[i]->_circles.end() );
 
-  //  Mat enhanced, enhancedBGR;
-  //  merge( channels, enhanced );
-  //  cvtColor( enhanced, enhancedBGR, CV_HSV2BGR );
-  //
-  //  imshow(enhancedWindow, enhancedBGR );
+    CircleDetection *merged = new CircleDetection( circles );
+    merged->corners.clear();
 
-    Mat gray;
-    diff.convertTo( gray, CV_8UC1, 255 );
-
-    const string grayWindow = "gray";
-    imwrite( "/tmp/diffGray.jpg", gray );
-
-    Mat blurred;
-    GaussianBlur( gray, blurred, Size(9,9), 2,2 );
-
-    Mat canny;
-    cv::Canny( blurred, canny, 50, 100 );
-    const string cannyWindow = "canny";
-    canny *= 255;
-    imwrite( "/tmp/diffCanny.jpg", canny );
-
-
-    vector<Vec3f> circles;
-    const float accumRes = 1, minDist = 4;
-    cv::HoughCircles( blurred, circles, CV_HOUGH_GRADIENT, accumRes, minDist, 100, 25 );
+    for( size_t i = 0; i < dets.size(); ++i ) {
+      if( !dets[i]->_circles.empty() ) {
+        const Vec3f &c( dets[i]->_circles.front() );
+        merged->add( ObjectPoint( 0, 0, 0 ), ImagePoint( c[0], c[1] ), i );
+      }
+      delete dets[i];
+    }
 
-    return new CircleDetection( circles );
+    return merged;
   }
 
 
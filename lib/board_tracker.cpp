@@ -0,0 +1,149 @@
+
+#include <algorithm>
+
+#include <opencv2/core/core.hpp>
+
+#include <glog/logging.h>
+
+#include "AplCam/board_tracker.h"
+
+namespace AplCam {
+
+  using namespace cv;
+
+  BoardTracker::BoardTracker( Board &board, const Params &params )
+    : _board( board ), _params( params ), _motion(), _regionSize(),
+      _lastCount( 0 ), _misses( 0 ), _lastCrop(), _stats()
+  {;}
+
+  void BoardTracker::reset( void )
+  {
+    _motion.reset();
+    _lastCount = 0;
+    _misses = 0;
+  }
+
+  Detection *BoardTracker::detect( PreparedFrame &frame )
+  {
+    const Mat &img( frame.image() );
+
+    ++_stats.frames;
+    _lastCrop = Rect();
+
+    Detection *det = NULL;
+
+    Rect crop;
+    if( predict( img.size(), crop ) ) {
+      _lastCrop = crop;
+
+      // Some detectors want contiguous data
+      Mat roi( img, crop );
+      if( !roi.isContinuous() ) roi = roi.clone();
+
+      PreparedFrame cropFrame( roi );
+      det = _board.detect( cropFrame );
+      if( acceptable( det ) ) {
+        det->offset( ImagePoint( crop.x, crop.y ) );
+        ++_stats.cropHits;
+      } else {
+        delete det;
+        det = NULL;
+        ++_stats.cropMisses;
+      }
+    }
+
+    if( det == NULL ) {
+      ++_stats.fullFrame;
+      det = _board.detect( frame );
+    }
+
+    if( det != NULL && det->size() >= (unsigned int)_params.minPoints ) {
+      update( *det );
+    } else if( _motion && ++_misses > _params.maxMisses ) {
+      reset();
+    }
+
+    return det;
+  }
+
+  bool BoardTracker::acceptable( const Detection *det ) const
+  {
+    if( det == NULL ) return false;
+
+    const unsigned int required = std::max( (unsigned int)_params.minPoints,
+                                            (unsigned int)( _params.keepFraction * _lastCount ) );
+    return det->size() >= required;
+  }
+
+  bool BoardTracker::predict( const cv::Size &imgSize, cv::Rect &crop )
+  {
+    if( !_motion ) return false;
+
+    Location loc( _motion->predict() );
+
+    const float padX = std::max<float>( _params.minPad, _params.margin * _regionSize.width + 3 * sqrt( loc.cov.x ) ),
+                padY = std::max<float>( _params.minPad, _params.margin * _regionSize.height + 3 * sqrt( loc.cov.y ) );
+    const float halfW = _regionSize.width / 2 + padX,
+                halfH = _regionSize.height / 2 + padY;
+
+    Rect r( floor( loc.pt.x - halfW ), floor( loc.pt.y - halfH ),
+            ceil( 2 * halfW ), ceil( 2 * halfH ) );
+    crop = r & Rect( 0, 0, imgSize.width, imgSize.height );
+
+    if( crop.area() == 0 ) return false;
+
+    return crop.area() <= _params.maxCropFraction * imgSize.area();
+  }
+
+  void BoardTracker::update( const Detection &det )
+  {
+    Rect_<float> region;
+    if( !boardRegion( det, region ) ) return;
+
+    const Point2f center( region.x + region.width / 2, region.y + region.height / 2 );
+
+    if( _motion )
+      _motion->update( center );
+    else
+      _motion.reset( new DecayingVelocityMotionModel( center ) );
+
+    _regionSize = region.size();
+    _lastCount = det.size();
+    _misses = 0;
+  }
+
+  bool BoardTracker::boardRegion( const Detection &det, cv::Rect_<float> &region ) const
+  {
+    if( det.size() == 0 ) return false;
+
+    // The detected points alone
+    float x0 = det.points[0][0], x1 = x0, y0 = det.points[0][1], y1 = y0;
+    for( size_t i = 1; i < det.size(); ++i ) {
+      x0 = std::min( x0, det.points[i][0] );  x1 = std::max( x1, det.points[i][0] );
+      y0 = std::min( y0, det.points[i][1] );  y1 = std::max( y1, det.points[i][1] );
+    }
+
+    // With enough points, include the parts of the board which weren't seen
+    if( det.size() >= 4 && det.corners.size() == det.size() ) {
+      Mat H( det.boardToImageH() );
+
+      if( !H.empty() ) {
+        ObjectPointsVec ext;
+        _board.extents( ext );
+
+        vector< Point2f > board( ext.size() ), image;
+        for( size_t i = 0; i < ext.size(); ++i ) board[i] = Point2f( ext[i][0], ext[i][1] );
+        perspectiveTransform( board, image, H );
+
+        for( size_t i = 0; i < image.size(); ++i ) {
+          x0 = std::min( x0, image[i].x );  x1 = std::max( x1, image[i].x );
+          y0 = std::min( y0, image[i].y );  y1 = std::max( y1, image[i].y );
+        }
+      }
+    }
+
+    region = Rect_<float>( x0, y0, x1 - x0, y1 - y0 );
+    return true;
+  }
+
+}
@@ -0,0 +1,153 @@
+#include <math.h>
+
+#include <queue>
+#include <iomanip>
+
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/calib3d/calib3d.hpp>
+
+#include <glog/logging.h>
+
+#include "AplCam/calib_frame_selectors/calib_frame_selectors.h"
+
+namespace AplCam {
+
+  namespace CalibFrameSelectors {
+
+    using namespace cv;
+
+    void CoverageFrameSelector::cells( const Detection &det, const Size &imageSize, vector< int > &out ) const
+    {
+      out.clear();
+
+      const float sx = float(_grid.width) / imageSize.width,
+                  sy = float(_grid.height) / imageSize.height;
+
+      for( size_t i = 0; i < det.points.size(); ++i ) {
+        const int cx = std::min( std::max( int( det.points[i][0] * sx ), 0 ), _grid.width-1 ),
+                  cy = std::min( std::max( int( det.points[i][1] * sy ), 0 ), _grid.height-1 );
+        out.push_back( cy * _grid.width + cx );
+      }
+
+      if( _poseBins > 0 && det.corners.size() >= 4 ) {
+        // Board tilt from the perspective row of the board->image
+        // homography, scaled by the board's extent so it's unitless
+        Mat h( det.boardToImageH() );
+
+        if( !h.empty() ) {
+          Matx33d H( h );
+          H *= 1.0 / H(2,2);
+
+          float extent = 0;
+          for( size_t i = 0; i < det.corners.size(); ++i )
+            extent = std::max( extent, std::max( fabs( det.corners[i][0] ), fabs( det.corners[i][1] ) ) );
+
+          const double px = H(2,0) * extent, py = H(2,1) * extent;
+          const double mag = sqrt( px*px + py*py );
+
+          // Roughly:  frontal, moderately tilted, strongly tilted
+          const int magBin = (mag < 0.05) ? 0 : ((mag < 0.2) ? 1 : 2);
+
+          int dirBin = 0;
+          if( magBin > 0 )
+            dirBin = std::min( int( (atan2( py, px ) + M_PI) / (2*M_PI) * _poseBins ), _poseBins-1 );
+
+          out.push_back( _grid.area() + magBin * _poseBins + dirBin );
+        }
+      }
+
+      std::sort( out.begin(), out.end() );
+      out.erase( std::unique( out.begin(), out.end() ), out.end() );
+    }
+
+    // Candidate in the lazy-greedy queue;  gain is an upper bound
+    struct CoverageCandidate {
+      CoverageCandidate( int g, size_t i ) : gain( g ), idx( i ) {;}
+
+      int gain;
+      size_t idx;
+
+      // Ties go to the earlier frame
+      bool operator<( const CoverageCandidate &other ) const
+      { return gain < other.gain || (gain == other.gain && idx > other.idx); }
+    };
+
+    void CoverageFrameSelector::generate( DetectionDb &db, DetectionSet &set )
+    {
+      Size imageSize( _imageSize.area() > 0 ? _imageSize : db.imageSize() );
+      if( imageSize.area() <= 0 ) {
+        LOG(ERROR) << "Image size not given and not available from the detection db";
+        return;
+      }
+
+      // Only the cell lists are kept for each candidate, flat
+      vector< int > frames, cellIdx;
+      vector< size_t > offsets( 1, 0 );
+      vector< int > c;
+
+      const bool visited = db.visitFrames( [&]( int f, const Detection &det ) {
+        if( det.size() == 0 ) return;
+        if( minTagCriteriaGiven() && !hasMinTags( &det ) ) return;
+
+        cells( det, imageSize, c );
+
+        frames.push_back( f );
+        cellIdx.insert( cellIdx.end(), c.begin(), c.end() );
+        offsets.push_back( cellIdx.size() );
+      });
+
+      if( !visited ) {
+        LOG(ERROR) << "Coverage selection needs a detection db with a known video length (e.g. FrameIndexedDetectionDb)";
+        return;
+      }
+
+      const int numCells = _grid.area() + (_poseBins > 0 ? TiltMagnitudeBins * _poseBins : 0);
+      vector< int > coverage( numCells, 0 );
+
+      std::priority_queue< CoverageCandidate > queue;
+      for( size_t i = 0; i < frames.size(); ++i )
+        queue.push( CoverageCandidate( offsets[i+1] - offsets[i], i ) );
+
+      vector< int > selected;
+      while( (long int)selected.size() < _count && !queue.empty() ) {
+        CoverageCandidate top( queue.top() );
+        queue.pop();
+
+        // Re-evaluate against current coverage
+        int gain = 0;
+        for( size_t k = offsets[top.idx]; k < offsets[top.idx+1]; ++k )
+          if( coverage[ cellIdx[k] ] < _depth ) ++gain;
+
+        if( gain == 0 ) continue;
+
+        // Still at least as good as the next best upper bound?  Then it's
+        // the true best.
+        if( !queue.empty() && gain < queue.top().gain ) {
+          queue.push( CoverageCandidate( gain, top.idx ) );
+          continue;
+        }
+
+        for( size_t k = offsets[top.idx]; k < offsets[top.idx+1]; ++k )
+          ++coverage[ cellIdx[k] ];
+
+        selected.push_back( frames[top.idx] );
+      }
+
+      int covered = 0;
+      for( int i = 0; i < numCells; ++i ) if( coverage[i] >= _depth ) ++covered;
+      LOG(INFO) << "Selected " << selected.size() << " of " << frames.size() << " frames covering "
+                << covered << " of " << numCells << " cells";
+
+      std::sort( selected.begin(), selected.end() );
+      for( size_t i = 0; i < selected.size(); ++i ) {
+        std::shared_ptr<Detection> det( db.atFrame( selected[i] ) );
+        if( det ) set.addDetection( *det, selected[i] );
+      }
+
+      stringstream strm;
+      strm << "coverage(" << _count << "," << _grid.width << "x" << _grid.height << ")_" << intsToHex( set.frames() );
+      set.setName( strm.str() );
+    }
+
+  }
+}
@@ -1,9 +1,13 @@
 #include <stdlib.h>
+#include <math.h>
 
 #include <iostream>
 #include <iomanip>
 
 #include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/calib3d/calib3d.hpp>
+
+#include <glog/logging.h>
 
 #include "AplCam/calib_frame_selectors/calib_frame_selectors.h"
 
@@ -29,10 +33,110 @@ struct PerspectiveMapTx {
 };
 
 
-void KeyframeFrameSelector::generate( DetectionDb &db, DetectionSet &set )
+//-- Polygon helpers for the overlap calculation --
+
+typedef vector< Vec2d > Polygon;
+
+static double polygonArea( const Polygon &poly )
+{
+  double area = 0.0;
+  for( size_t i = 0, j = poly.size()-1; i < poly.size(); j = i++ )
+    area += poly[j][0]*poly[i][1] - poly[i][0]*poly[j][1];
+  return fabs( area ) / 2.0;
+}
+
+// One Sutherland-Hodgman step:  clip poly against the half-plane
+// n . p <= d
+static Polygon clipHalfPlane( const Polygon &poly, const Vec2d &n, double d )
+{
+  Polygon out;
+  if( poly.empty() ) return out;
+
+  for( size_t i = 0, j = poly.size()-1; i < poly.size(); j = i++ ) {
+    const Vec2d &a( poly[j] ), &b( poly[i] );
+    const double da = n.dot(a) - d, db = n.dot(b) - d;
+
+    if( da <= 0 ) out.push_back( a );
+    if( (da < 0 && db > 0) || (da > 0 && db < 0) )
+      out.push_back( a + (b-a) * (da / (da - db)) );
+  }
+
+  return out;
+}
+
+// Area of the intersection of quad with the unit square
+static double unitSquareIntersection( const Polygon &quad )
 {
-  Detection *det;
+  Polygon p( quad );
+  p = clipHalfPlane( p, Vec2d( -1,  0 ), 0 );
+  p = clipHalfPlane( p, Vec2d(  1,  0 ), 1 );
+  p = clipHalfPlane( p, Vec2d(  0, -1 ), 0 );
+  p = clipHalfPlane( p, Vec2d(  0,  1 ), 1 );
+
+  return p.size() < 3 ? 0.0 : polygonArea( p );
+}
+
+// Fraction of the unit square which tx maps back into the unit square.
+// That region is the unit square intersected with the image of the unit
+// square under tx^-1, which is a quadrilateral.
+static double unitSquareOverlap( const Matx33d &tx )
+{
+  const Matx33d txInv( tx.inv() );
+  const double sq[4][2] = { {0,0}, {1,0}, {1,1}, {0,1} };
+
+  // The homography is only defined up to scale, so its sign is
+  // arbitrary.  A valid quad has all four w of the same sign;  mixed
+  // signs (or a zero) mean a corner is at or beyond the line at
+  // infinity, and the board can't overlap meaningfully.
+  Vec3d p[4];
+  int positive = 0;
+  for( int c = 0; c < 4; ++c ) {
+    p[c] = txInv * Vec3d( sq[c][0], sq[c][1], 1.0 );
+    if( p[c][2] == 0 ) return 0.0;
+    if( p[c][2] > 0 ) ++positive;
+  }
+
+  if( positive != 0 && positive != 4 ) return 0.0;
+
+  Polygon quad;
+  for( int c = 0; c < 4; ++c )
+    quad.push_back( Vec2d( p[c][0]/p[c][2], p[c][1]/p[c][2] ) );
+
+  return unitSquareIntersection( quad );
+}
+
+//-- Homographies for all candidate frames, in parallel --
+
+// As Detection::boardToImageH(), on the flat copy
+struct BoardToImageHBody : public ParallelLoopBody {
+  BoardToImageHBody( const FlatDetections &dets,
+                     vector< Matx33d > &hs, vector< uchar > &valid )
+    : _dets( dets ), _hs( hs ), _valid( valid )
+  {;}
+
+  virtual void operator()( const Range &r ) const
+  {
+    ImagePointsVec crn;
+    for( int i = r.start; i < r.end; ++i ) {
+      const DetectionView det( _dets[i] );
+
+      crn.resize( det.size() );
+      for( size_t j = 0; j < det.size(); ++j ) crn[j] = ImagePoint( det.corners[j][0], det.corners[j][1] );
 
+      Mat h( findHomography( crn, det.pointsMat() ) );
+      _valid[i] = !h.empty();
+      if( _valid[i] ) _hs[i] = Matx33d( h );
+    }
+  }
+
+  const FlatDetections &_dets;
+  vector< Matx33d > &_hs;
+  vector< uchar > &_valid;
+};
+
+
+void KeyframeFrameSelector::generate( DetectionDb &db, DetectionSet &set )
+{
   ObjectPointsVec boardExtent;
   _board.extents( boardExtent );
 
@@ -59,105 +163,45 @@ void KeyframeFrameSelector::generate( DetectionDb &db, DetectionSet &set )
 
   Matx33d toUnitSq = getPerspectiveTransform( bd, sq );
   Matx33d toUnitSqInv( toUnitSq.inv() );
-  Matx33d prevHinv;
-
-#ifdef DO_DRAW
-  const string KeyframeDebugWindowName = "keyframe_frame_selector_debug";
-  namedWindow( KeyframeDebugWindowName );
-  ImagePointsVec prevPts;
-#endif
-
-
-  bool first = true;
-  size_t vidLength = 0; // db.vidLength();
-  for( size_t i = 0; i < vidLength; ++i ) {
-    //det = db.load( i );
-
-    if( det == NULL ) continue;
 
-    int minTags = std::max( _minTags, 4 );
-    if( det->points.size() < minTags ) continue;
+  // Gather candidates into one flat copy
+  const size_t minTags = std::max( _minTags, 4 );
+  FlatDetections dets;
 
-    Matx33d h = det->boardToImageH();
+  const bool visited = db.visitFrames( [&]( int frame, const Detection &det ) {
+    if( det.points.size() >= minTags ) dets.add( det, frame );
+  });
 
-#ifdef DO_DRAW
-    Mat canvas( Mat::zeros( 1080, 1920, CV_8UC3 ) ) ;
-
-    // Current points
-    for( size_t c = 0; c < det->points.size(); ++c ) {
-      Point pt( det->points[c][0], det->points[c][1] );
-      circle( canvas, pt, 5, Scalar(0,0,255), 1 );
-    }
+  if( !visited ) {
+    LOG(ERROR) << "Keyframe selection needs a detection db with a known video length (e.g. FrameIndexedDetectionDb)";
+    return;
+  }
 
-    for( size_t c = 0; c < prevPts.size(); ++c ) {
-      Point pt( prevPts[c][0], prevPts[c][1] );
-      circle( canvas, pt, 5, Scalar(255,0,0), 1 );
-    }
+  // Homography estimation is independent per frame
+  vector< Matx33d > hs( dets.size() );
+  vector< uchar > valid( dets.size(), 0 );
+  parallel_for_( Range( 0, (int)dets.size() ), BoardToImageHBody( dets, hs, valid ) );
 
-    // Draw the bounding rectangles for the two boards
-    vector< Point2f > bbPrev, bbThis;
-    for( size_t c = 0; c < sq.size(); ++c ) {
-      Vec3f s( sq[c].x, sq[c].y, 1.0 );
-      Vec3f p = prevHinv.inv() * toUnitSqInv * s;
-      bbPrev.push_back( Point2f( p[0]/p[2], p[1]/p[2] ) );
+  // Keyframe decisions are sequential
+  bool first = true;
+  Matx33d prevHinv;
+  for( size_t i = 0; i < dets.size(); ++i ) {
+    if( !valid[i] ) continue;
 
-      p = h * toUnitSqInv * s;
-      cout << p << endl;
-      bbThis.push_back( Point2f( p[0]/p[2], p[1]/p[2] ) );
-    }
+    const Matx33d &h( hs[i] );
 
-    for( size_t i = 0; i < 3; ++i ) {
-      line( canvas, bbPrev[i], bbPrev[i+1], Scalar(255,0,0), 1 );
-      line( canvas, bbThis[i], bbThis[i+1], Scalar(0,0,255), 1 );
-    }
-    line( canvas, bbPrev[3], bbPrev[0], Scalar(255,0,0), 1 );
-    line( canvas, bbThis[3], bbThis[0], Scalar(0,0,255), 1 );
-#endif
-
-
-    if( first ) {
-      set.addDetection( det, i );
-      prevHinv = h.inv();
-#ifdef DO_DRAW
-      prevPts = det->points;
-#endif
-      first = false;
-      continue;
-    }
+    if( !first ) {
+      // Fraction of this board (in its unit square) which falls within
+      // the previous keyframe's board
+      Matx33d tx = toUnitSq * prevHinv * h * toUnitSqInv;
+      double overlap = unitSquareOverlap( tx );
 
-    // Estimate overlap numerically
-    // Draw points from unit square, transform to board space, to image space, then back again.
-    const int numRand = 1000;
-    int inOverlap = 0;
-    Matx33f tx = toUnitSq * prevHinv * h * toUnitSqInv;
-    for( int p = 0; p < numRand; ++p ) {
-      Vec3f o = tx * Vec3f( drand48(), drand48(), 1.0 );
-      Point2f op( o[0]/o[2], o[1]/o[2] );
-
-      if( op.x >= 0.0 && op.x < 1.0 &&
-         op.y >= 0.0 && op.y < 1.0 ) ++inOverlap;
+      if( overlap >= _minOverlap ) continue;
     }
 
-    float overlap = inOverlap * 1.0 / numRand;
-
-    //cout << std::setprecision(2) << "Overlap " << overlap << endl;
-
-#ifdef DO_DRAW
-    imshow( KeyframeDebugWindowName, canvas );
-    waitKey(0);
-#endif
-
-
-    if( overlap < _minOverlap ) {
-      set.addDetection( det, i );
-      prevHinv = h.inv();
-#ifdef DO_DRAW
-      prevPts = det->points;
-#endif
-    } else {
-      // Only delete if not added to a set
-      delete det;
-    }
+    set.addDetection( dets[i] );
+    prevHinv = h.inv();
+    first = false;
   }
 
   stringstream strm;
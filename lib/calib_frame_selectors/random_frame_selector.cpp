@@ -1,3 +1,7 @@
+#include <algorithm>
+
+#include <glog/logging.h>
+
 #include "AplCam/calib_frame_selectors/calib_frame_selectors.h"
 
 namespace AplCam {
@@ -6,37 +10,33 @@ namespace AplCam {
 
     void RandomFrameSelector::generate( DetectionDb &db, DetectionSet &set )
     {
-      // vector< int > keys;
-      //
-      // DB::Cursor *cur = db.cursor();
-      // cur->jump();
-      //
-      // string key;
-      // while( cur->get_key( &key, true) )
-      //   if( isNotMeta( key ) ) {
-      //     if( minTagCriteriaGiven() ) {
-      //       int frame = stoi( key );
-      //       Detection *detection = db.load( frame );
-      //       if( hasMinTags( detection ) ) keys.push_back( frame );
-      //     } else {
-      //       keys.push_back( stoi( key ) );
-      //     }
-      //   }
-      //
-      // //          delete cur;
-      //
-      // long int c = std::min( _count, (long int)keys.size() );
-      //
-      // std::random_shuffle( keys.begin(), keys.end(), unaryRandom );
-      // keys.resize( c );
-      //
-      // for( vector< int >::iterator itr = keys.begin(); itr != keys.end(); ++itr ) {
-      //   set.addDetection( db, *itr );
-      // }
-      //
-      // std::stringstream strm;
-      // strm << "random(" << _count << ")_" << intsToHex( set.frames() );
-      // set.setName( strm.str() );
+      // Sample frame numbers only;  the few detections kept are fetched
+      // afterwards
+      Reservoir< int > reservoir( std::max( _count, 0L ), _seed );
+
+      const bool visited = db.visitFrames( [&]( int frame, const Detection &detection ) {
+        if( minTagCriteriaGiven() && !hasMinTags( &detection ) ) return;
+        reservoir.add( frame );
+      });
+
+      if( !visited ) {
+        LOG(ERROR) << "Random selection needs a detection db with a known video length (e.g. FrameIndexedDetectionDb)";
+        return;
+      }
+
+      // Add in frame order
+      vector< int > samples( reservoir.items() );
+      std::sort( samples.begin(), samples.end() );
+
+      set.reserve( samples.size(), 0 );
+      for( vector< int >::iterator itr = samples.begin(); itr != samples.end(); ++itr ) {
+        std::shared_ptr<Detection> detection( db.atFrame( *itr ) );
+        if( detection ) set.addDetection( *detection, *itr );
+      }
+
+      std::stringstream strm;
+      strm << "random(" << _count << ")_" << intsToHex( set.frames() );
+      set.setName( strm.str() );
     }
 
   }
@@ -27,7 +27,26 @@ namespace AplCam {
       for( size_t i = 0; i < _det.size(); ++i ) {
         add( worldLocations[i], Point2f( _det[i].cxy.first, _det[i].cxy.second ), _det[i].id );
       }
+
+      sortById();
+    }
+
+  void AprilTagsDetection::offset( const ImagePoint &d )
+  {
+    Detection::offset( d );
+
+    // The tag homographies are relative to hxy, so shifting it is enough
+    for( size_t i = 0; i < _det.size(); ++i ) {
+      AprilTags::TagDetection &tag( _det[i] );
+
+      tag.cxy.first += d[0];   tag.cxy.second += d[1];
+      tag.hxy.first += d[0];   tag.hxy.second += d[1];
+      for( int j = 0; j < 4; ++j ) {
+        tag.p[j].first += d[0];
+        tag.p[j].second += d[1];
+      }
     }
+  }
 
 
   //
@@ -171,7 +190,7 @@ namespace AplCam {
     // Now actually drop outliers.  Awkward right now
     ObjectPointsVec oldWld( corners );
     ImagePointsVec oldImg( points );
-    vector< int > oldIds;
+    vector< int > oldIds( ids );
 
     corners.clear();
     points.clear();
@@ -22,3 +22,13 @@ void CircleDetection::drawCorners( const Board &board, Mat &view ) const
     cv::circle( view, Point( _circles[i][0], _circles[i][1] ), _circles[i][2], Scalar( 0, 0, 255 ), 1 );
   }
 }
+
+void CircleDetection::offset( const ImagePoint &d )
+{
+  Detection::offset( d );
+
+  for( size_t i = 0; i < _circles.size(); ++i ) {
+    _circles[i][0] += d[0];
+    _circles[i][1] += d[1];
+  }
+}
@@ -1,5 +1,6 @@
 
 #include <iostream>
+#include <algorithm>
 
 #include <opencv2/core/core.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
@@ -72,6 +73,11 @@ Mat Detection::boardToImageH( void ) const
 
 
 
+void Detection::offset( const ImagePoint &d )
+{
+  for( size_t i = 0; i < points.size(); ++i ) points[i] += d;
+}
+
 
 //============================================================================
 //  Serialization/unserialization methods
@@ -161,23 +167,71 @@ Detection *Detection::unserializeFromFileStorage( const FileStorage &fs )
   return detection;
 }
 
+void Detection::sortById( void )
+{
+  if( ids.size() != points.size() || isSortedById() ) return;
+
+  vector< size_t > order( ids.size() );
+  for( size_t i = 0; i < order.size(); ++i ) order[i] = i;
+  std::stable_sort( order.begin(), order.end(),
+                    [&]( size_t a, size_t b ) { return ids[a] < ids[b]; } );
+
+  ImagePointsVec sortedPts( points.size() );
+  ObjectPointsVec sortedCorners( corners.size() );
+  vector< int > sortedIds( ids.size() );
+
+  for( size_t i = 0; i < order.size(); ++i ) {
+    sortedPts[i] = points[ order[i] ];
+    if( !corners.empty() ) sortedCorners[i] = corners[ order[i] ];
+    sortedIds[i] = ids[ order[i] ];
+  }
+
+  points.swap( sortedPts );
+  corners.swap( sortedCorners );
+  ids.swap( sortedIds );
+}
+
+bool Detection::isSortedById( void ) const
+{
+  return std::is_sorted( ids.begin(), ids.end() );
+}
+
+// Indices of det's points in ascending id order.  Just 0..n-1 if the
+// detection is already sorted.
+static vector< size_t > idOrder( const Detection &det )
+{
+  vector< size_t > order( det.ids.size() );
+  for( size_t i = 0; i < order.size(); ++i ) order[i] = i;
+
+  if( !det.isSortedById() )
+    std::stable_sort( order.begin(), order.end(),
+                      [&]( size_t a, size_t b ) { return det.ids[a] < det.ids[b]; } );
+
+  return order;
+}
+
 SharedPoints Detection::sharedWith( const Detection &a, const Detection &b )
 {
   SharedPoints shared;
 
-  for( unsigned int i = 0; i < a.size(); ++i ) {
-    for( unsigned int j = 0; j < b.size(); ++j ) {
+  // Merge the two id lists.  Linear if both are sorted, n log n otherwise
+  const vector< size_t > orderA( idOrder( a ) ), orderB( idOrder( b ) );
+
+  size_t i = 0, j = 0;
+  while( i < orderA.size() && j < orderB.size() ) {
+    const size_t ia = orderA[i], jb = orderB[j];
 
-      if( a.ids[i] == b.ids[j] ) {
-        //      cout << "Comparing " << a.ids[i] << " to " << b.ids[j] << endl;
-        //      cout << a.points[i] << b.points[j] << a.corners[i] << endl;
-        shared.imagePoints[0].push_back( a.points[i] );
-        shared.imagePoints[1].push_back( b.points[j] );
+    if( a.ids[ia] < b.ids[jb] ) {
+      ++i;
+    } else if( b.ids[jb] < a.ids[ia] ) {
+      ++j;
+    } else {
+      shared.imagePoints[0].push_back( a.points[ia] );
+      shared.imagePoints[1].push_back( b.points[jb] );
 
-        assert( a.corners[i] == b.corners[j] );
-        shared.worldPoints.push_back( a.corners[i] );
-        break;
-      }
+      assert( a.corners[ia] == b.corners[jb] );
+      shared.worldPoints.push_back( a.corners[ia] );
+      ++i;  ++j;
     }
   }
 
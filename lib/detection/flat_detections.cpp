@@ -0,0 +1,122 @@
+
+#include "AplCam/detection/flat_detections.h"
+
+namespace AplCam {
+
+  using cv::Mat;
+
+  Mat DetectionView::pointsMat( void ) const
+  {
+    return Mat( points.size(), 1, CV_32FC2, const_cast< ImagePoint * >( points.data() ) );
+  }
+
+  Mat DetectionView::cornersMat( void ) const
+  {
+    return Mat( corners.size(), 1, CV_32FC3, const_cast< ObjectPoint * >( corners.data() ) );
+  }
+
+  //===================================================================
+
+  void FlatDetections::reserve( size_t frames, size_t points )
+  {
+    _frames.reserve( frames );
+    _offsets.reserve( frames + 1 );
+
+    _points.reserve( points );
+    _corners.reserve( points );
+    _ids.reserve( points );
+  }
+
+  void FlatDetections::clear( void )
+  {
+    _points.clear();
+    _corners.clear();
+    _ids.clear();
+    _frames.clear();
+    _offsets.assign( 1, 0 );
+  }
+
+  void FlatDetections::add( const Detection &det, int frame )
+  {
+    CV_Assert( det.corners.size() == det.points.size() );
+
+    _points.insert( _points.end(), det.points.begin(), det.points.end() );
+    _corners.insert( _corners.end(), det.corners.begin(), det.corners.end() );
+
+    // Not every detector fills in ids
+    if( det.ids.size() == det.points.size() )
+      _ids.insert( _ids.end(), det.ids.begin(), det.ids.end() );
+    else
+      _ids.resize( _points.size(), -1 );
+
+    _frames.push_back( frame );
+    _offsets.push_back( _points.size() );
+  }
+
+  void FlatDetections::add( const DetectionView &view )
+  {
+    _points.insert( _points.end(), view.points.begin(), view.points.end() );
+    _corners.insert( _corners.end(), view.corners.begin(), view.corners.end() );
+    _ids.insert( _ids.end(), view.ids.begin(), view.ids.end() );
+
+    _frames.push_back( view.frame );
+    _offsets.push_back( _points.size() );
+  }
+
+  void FlatDetections::compact( const vector< bool > &keep )
+  {
+    CV_Assert( keep.size() == size() );
+
+    size_t out = 0, outFrame = 0;
+    for( size_t i = 0; i < size(); ++i ) {
+      if( !keep[i] ) continue;
+
+      const size_t start = _offsets[i], n = count(i);
+
+      // Moving towards the front, so never overwrites unread data
+      std::copy( _points.begin() + start, _points.begin() + start + n, _points.begin() + out );
+      std::copy( _corners.begin() + start, _corners.begin() + start + n, _corners.begin() + out );
+      std::copy( _ids.begin() + start, _ids.begin() + start + n, _ids.begin() + out );
+
+      _frames[outFrame] = _frames[i];
+      out += n;
+      _offsets[++outFrame] = out;
+    }
+
+    _points.resize( out );
+    _corners.resize( out );
+    _ids.resize( out );
+    _frames.resize( outFrame );
+    _offsets.resize( outFrame + 1 );
+  }
+
+  DetectionView FlatDetections::operator[]( size_t i ) const
+  {
+    DetectionView view;
+    const size_t start = _offsets[i], n = count(i);
+
+    view.frame = _frames[i];
+    view.points  = ImagePointsView( _points.data() + start, n );
+    view.corners = ObjectPointsView( _corners.data() + start, n );
+    view.ids     = IdsView( _ids.data() + start, n );
+
+    return view;
+  }
+
+  ImagePointsVecVec FlatDetections::imagePointsVecVec( void ) const
+  {
+    ImagePointsVecVec out( size() );
+    for( size_t i = 0; i < size(); ++i )
+      out[i].assign( _points.begin() + _offsets[i], _points.begin() + _offsets[i+1] );
+    return out;
+  }
+
+  ObjectPointsVecVec FlatDetections::objectPointsVecVec( void ) const
+  {
+    ObjectPointsVecVec out( size() );
+    for( size_t i = 0; i < size(); ++i )
+      out[i].assign( _corners.begin() + _offsets[i], _corners.begin() + _offsets[i+1] );
+    return out;
+  }
+
+}
@@ -0,0 +1,264 @@
+
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "libg3logger/g3logger.h"
+
+#include "AplCam/detection_archive.h"
+
+namespace AplCam {
+
+  using namespace std;
+
+  static const char ArchiveMagic[8] = { 'A', 'P', 'L', 'D', 'E', 'T', 'A', '1' };
+  static const uint32_t ByteOrderMark = 0x01020304;
+
+  // Sections start on 16-byte boundaries
+  static uint64_t align( uint64_t offset )
+  { return (offset + 15) & ~(uint64_t)15; }
+
+  // True if count elements of size starting at offset lie within the
+  // file, without overflowing.  Every section is 16-byte aligned.
+  static bool sectionFits( uint64_t offset, uint64_t count, uint64_t size, uint64_t fileSize )
+  {
+    if( offset % 16 != 0 || offset > fileSize ) return false;
+    return count <= (fileSize - offset) / size;
+  }
+
+  DetectionArchive::DetectionArchive( void )
+    : _map( NULL ), _mapSize( 0 ), _header( NULL ),
+      _frames( NULL ), _offsets( NULL ), _points( NULL ), _corners( NULL ), _ids( NULL )
+  {;}
+
+  DetectionArchive::DetectionArchive( const std::string &filename )
+    : _map( NULL ), _mapSize( 0 ), _header( NULL ),
+      _frames( NULL ), _offsets( NULL ), _points( NULL ), _corners( NULL ), _ids( NULL )
+  {
+    open( filename );
+  }
+
+  DetectionArchive::~DetectionArchive()
+  {
+    close();
+  }
+
+  bool DetectionArchive::open( const std::string &filename )
+  {
+    close();
+
+    int fd = ::open( filename.c_str(), O_RDONLY );
+    if( fd < 0 ) {
+      LOG(WARNING) << "Unable to open detection archive " << filename;
+      return false;
+    }
+
+    struct stat st;
+    if( fstat( fd, &st ) != 0 || (size_t)st.st_size < sizeof(Header) ) {
+      LOG(WARNING) << "Detection archive " << filename << " is too short";
+      ::close( fd );
+      return false;
+    }
+
+    void *map = mmap( NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+    ::close( fd );
+
+    if( map == MAP_FAILED ) {
+      LOG(WARNING) << "Unable to mmap detection archive " << filename;
+      return false;
+    }
+
+    _map = map;
+    _mapSize = st.st_size;
+    _header = reinterpret_cast< const Header * >( _map );
+
+    if( !validate( _mapSize ) ) {
+      LOG(WARNING) << "Detection archive " << filename << " is invalid or of an unknown version";
+      close();
+      return false;
+    }
+
+    const char *base = reinterpret_cast< const char * >( _map );
+    _frames  = reinterpret_cast< const int32_t * >( base + _header->framesOffset );
+    _offsets = reinterpret_cast< const uint64_t * >( base + _header->offsetsOffset );
+    _points  = reinterpret_cast< const ImagePoint * >( base + _header->pointsOffset );
+    _corners = reinterpret_cast< const ObjectPoint * >( base + _header->cornersOffset );
+    _ids     = reinterpret_cast< const int32_t * >( base + _header->idsOffset );
+
+    return true;
+  }
+
+  void DetectionArchive::close( void )
+  {
+    if( _map ) munmap( _map, _mapSize );
+
+    _map = NULL;
+    _mapSize = 0;
+    _header = NULL;
+    _frames = NULL;
+    _offsets = NULL;
+    _points = NULL;
+    _corners = NULL;
+    _ids = NULL;
+  }
+
+  bool DetectionArchive::validate( size_t fileSize ) const
+  {
+    const Header &h( *_header );
+
+    if( memcmp( h.magic, ArchiveMagic, sizeof(ArchiveMagic) ) != 0 ) return false;
+    if( h.version != Version || h.byteOrder != ByteOrderMark ) return false;
+    if( h.headerSize != sizeof(Header) || h.fileSize != fileSize ) return false;
+
+    // Every section must lie within the file and be aligned for its type
+    const uint64_t nf = h.numFrames, np = h.numPoints;
+    if( nf >= fileSize || np >= fileSize ) return false;
+
+    if( !sectionFits( h.framesOffset,  nf,   sizeof(int32_t),     fileSize ) ) return false;
+    if( !sectionFits( h.offsetsOffset, nf+1, sizeof(uint64_t),    fileSize ) ) return false;
+    if( !sectionFits( h.pointsOffset,  np,   sizeof(ImagePoint),  fileSize ) ) return false;
+    if( !sectionFits( h.cornersOffset, np,   sizeof(ObjectPoint), fileSize ) ) return false;
+    if( !sectionFits( h.idsOffset,     np,   sizeof(int32_t),     fileSize ) ) return false;
+
+    // Frame i's points are [offsets[i], offsets[i+1]), so the offsets must
+    // run from 0 to np without going backwards ...
+    const char *base = reinterpret_cast< const char * >( _map );
+    const uint64_t *offsets = reinterpret_cast< const uint64_t * >( base + h.offsetsOffset );
+    if( offsets[0] != 0 || offsets[nf] != np ) return false;
+    for( uint64_t i = 0; i < nf; ++i )
+      if( offsets[i+1] < offsets[i] ) return false;
+
+    // ... and find() binary searches the frame numbers
+    const int32_t *frames = reinterpret_cast< const int32_t * >( base + h.framesOffset );
+    for( uint64_t i = 1; i < nf; ++i )
+      if( frames[i] < frames[i-1] ) return false;
+
+    return true;
+  }
+
+  DetectionView DetectionArchive::operator[]( size_t i ) const
+  {
+    DetectionView view;
+    const uint64_t start = _offsets[i], n = _offsets[i+1] - start;
+
+    view.frame = _frames[i];
+    view.points  = ImagePointsView( _points + start, n );
+    view.corners = ObjectPointsView( _corners + start, n );
+    view.ids     = IdsView( reinterpret_cast< const int * >( _ids ) + start, n );
+
+    return view;
+  }
+
+  bool DetectionArchive::find( int frame, DetectionView &view ) const
+  {
+    if( !isOpen() ) return false;
+
+    const int32_t *end = _frames + _header->numFrames;
+    const int32_t *itr = std::lower_bound( _frames, end, frame );
+    if( itr == end || *itr != frame ) return false;
+
+    view = (*this)[ itr - _frames ];
+    return true;
+  }
+
+  //===================================================================
+
+  static void writePadding( ofstream &out, uint64_t to )
+  {
+    static const char zeros[16] = {0};
+    uint64_t pos = out.tellp();
+    if( to > pos ) out.write( zeros, to - pos );
+  }
+
+  bool DetectionArchive::Write( const std::string &filename, const FlatDetections &detections,
+                                unsigned int length, const cv::Size &imageSize, float fps )
+  {
+    // The index must be in frame order for find()
+    vector< size_t > order( detections.size() );
+    for( size_t i = 0; i < order.size(); ++i ) order[i] = i;
+    std::stable_sort( order.begin(), order.end(),
+                      [&]( size_t a, size_t b ) { return detections.frame(a) < detections.frame(b); } );
+
+    Header h;
+    memset( &h, 0, sizeof(h) );
+    memcpy( h.magic, ArchiveMagic, sizeof(ArchiveMagic) );
+    h.version = Version;
+    h.byteOrder = ByteOrderMark;
+    h.headerSize = sizeof(Header);
+    h.fps = fps;
+    h.width = imageSize.width;
+    h.height = imageSize.height;
+    h.length = length;
+    h.numFrames = detections.size();
+    h.numPoints = detections.totalPoints();
+
+    h.framesOffset  = align( sizeof(Header) );
+    h.offsetsOffset = align( h.framesOffset  + h.numFrames * sizeof(int32_t) );
+    h.pointsOffset  = align( h.offsetsOffset + (h.numFrames+1) * sizeof(uint64_t) );
+    h.cornersOffset = align( h.pointsOffset  + h.numPoints * sizeof(ImagePoint) );
+    h.idsOffset     = align( h.cornersOffset + h.numPoints * sizeof(ObjectPoint) );
+    h.fileSize      = h.idsOffset + h.numPoints * sizeof(int32_t);
+
+    ofstream out( filename.c_str(), ios::binary | ios::trunc );
+    if( !out.is_open() ) {
+      LOG(WARNING) << "Unable to write detection archive " << filename;
+      return false;
+    }
+
+    out.write( reinterpret_cast< const char * >( &h ), sizeof(h) );
+
+    writePadding( out, h.framesOffset );
+    for( size_t i = 0; i < order.size(); ++i ) {
+      const int32_t f = detections.frame( order[i] );
+      out.write( reinterpret_cast< const char * >( &f ), sizeof(f) );
+    }
+
+    writePadding( out, h.offsetsOffset );
+    uint64_t offset = 0;
+    out.write( reinterpret_cast< const char * >( &offset ), sizeof(offset) );
+    for( size_t i = 0; i < order.size(); ++i ) {
+      offset += detections.count( order[i] );
+      out.write( reinterpret_cast< const char * >( &offset ), sizeof(offset) );
+    }
+
+    // Each array is written a frame at a time, in the sorted order
+    writePadding( out, h.pointsOffset );
+    for( size_t i = 0; i < order.size(); ++i ) {
+      const size_t n = detections.count( order[i] );
+      if( n > 0 ) out.write( reinterpret_cast< const char * >( &detections.points()[ detections.offset( order[i] ) ] ), n * sizeof(ImagePoint) );
+    }
+
+    writePadding( out, h.cornersOffset );
+    for( size_t i = 0; i < order.size(); ++i ) {
+      const size_t n = detections.count( order[i] );
+      if( n > 0 ) out.write( reinterpret_cast< const char * >( &detections.corners()[ detections.offset( order[i] ) ] ), n * sizeof(ObjectPoint) );
+    }
+
+    writePadding( out, h.idsOffset );
+    for( size_t i = 0; i < order.size(); ++i ) {
+      const size_t n = detections.count( order[i] );
+      if( n > 0 ) out.write( reinterpret_cast< const char * >( &detections.ids()[ detections.offset( order[i] ) ] ), n * sizeof(int32_t) );
+    }
+
+    return out.good();
+  }
+
+  bool DetectionArchive::Write( const std::string &filename, const FrameIndexedDetectionDb &db )
+  {
+    FlatDetections flat;
+
+    size_t points = 0;
+    db.forEach( [&]( int frame, const Detection &det ) { points += det.size(); } );
+    flat.reserve( db.count(), points );
+
+    db.forEach( [&]( int frame, const Detection &det ) { flat.add( det, frame ); } );
+
+    return Write( filename, flat, db.length(), db.imageSize(), db.fps() );
+  }
+
+}
@@ -1,6 +1,8 @@
 
 #include <fstream>
 #include <iomanip>
+#include <cstdio>
+#include <cstdlib>
 
 #include "libg3logger/g3logger.h"
 
@@ -11,6 +13,54 @@ namespace AplCam {
 
   using namespace std;
 
+  const string DetectionDb::MetaKey = "meta",
+                DetectionDb::MetaFpsKey = "fps",
+                DetectionDb::MetaWidthKey = "width",
+                DetectionDb::MetaHeightKey = "height",
+                DetectionDb::MetaLengthKey = "length";
+
+  bool DetectionDb::insertFrame( int frame, const Detection &detection )
+  {
+    return insert( FrameToKey( frame ), std::shared_ptr<Detection>( new Detection( detection ) ) );
+  }
+
+  std::shared_ptr<Detection> DetectionDb::atFrame( int frame )
+  {
+    return at( FrameToKey( frame ) );
+  }
+
+  bool DetectionDb::visitFrames( const FrameVisitor &visit )
+  {
+    const unsigned int length = vidLength();
+    if( length == 0 ) return false;
+
+    for( unsigned int frame = 0; frame < length; ++frame ) {
+      std::shared_ptr<Detection> det( atFrame( frame ) );
+      if( det ) visit( frame, *det );
+    }
+
+    return true;
+  }
+
+  std::string DetectionDb::FrameToKey( int frame )
+  {
+    char frameKey[20];
+    snprintf( frameKey, 19, "%d", frame );
+
+    return string( frameKey );
+  }
+
+  bool DetectionDb::KeyToFrame( const std::string &key, int &frame )
+  {
+    char *end = NULL;
+    long f = strtol( key.c_str(), &end, 10 );
+
+    if( key.empty() || *end != '\0' ) return false;
+
+    frame = f;
+    return true;
+  }
+
   InMemoryDetectionDb::InMemoryDetectionDb(  )
     : _filename("")
   {
@@ -102,4 +152,175 @@ namespace AplCam {
   }
 
 
+  //======
+
+  // About ten hours at 30 fps
+  const size_t FrameIndexedDetectionDb::MaxFrameGap = 1 << 20;
+
+  FrameIndexedDetectionDb::FrameIndexedDetectionDb( )
+    : DetectionDb(), _detections(), _present(), _count(0),
+      _length(0), _imageSize(0,0), _fps(0)
+  {
+  }
+
+  FrameIndexedDetectionDb::~FrameIndexedDetectionDb()
+  {
+  }
+
+  void FrameIndexedDetectionDb::reserve( size_t frames )
+  {
+    _detections.reserve( frames );
+    _present.reserve( frames );
+  }
+
+  bool FrameIndexedDetectionDb::insertFrame( int frame, const Detection &detection )
+  {
+    if( frame < 0 ) return false;
+
+    const size_t limit = (_length > 0) ? _length : _present.size() + MaxFrameGap;
+    if( (size_t)frame >= limit ) {
+      LOG(WARNING) << "Frame " << frame << " is beyond the end of the frame-indexed db (" << limit << ")";
+      return false;
+    }
+
+    if( (size_t)frame >= _present.size() ) {
+      _detections.resize( frame+1 );
+      _present.resize( frame+1, false );
+    }
+
+    if( !_present[frame] ) ++_count;
+
+    _detections[frame] = detection;
+    _present[frame] = true;
+    return true;
+  }
+
+  std::shared_ptr<Detection> FrameIndexedDetectionDb::atFrame( int frame )
+  {
+    const Detection *det = find( frame );
+    if( !det ) return nullptr;
+
+    return std::shared_ptr<Detection>( new Detection( *det ) );
+  }
+
+  bool FrameIndexedDetectionDb::insert( const std::string &key, const std::shared_ptr<Detection> &detection )
+  {
+    int frame;
+    if( !detection || !KeyToFrame( key, frame ) ) {
+      LOG(WARNING) << "Can't insert non-integer key \"" << key << "\" into a frame-indexed db";
+      return false;
+    }
+
+    return insertFrame( frame, *detection );
+  }
+
+  std::shared_ptr<Detection> FrameIndexedDetectionDb::at( const std::string &key )
+  {
+    int frame;
+    if( !KeyToFrame( key, frame ) ) return nullptr;
+
+    return atFrame( frame );
+  }
+
+  bool FrameIndexedDetectionDb::setMeta( unsigned int length, int width, int height, float fps )
+  {
+    _length = length;
+    _imageSize = cv::Size( width, height );
+    _fps = fps;
+
+    reserve( length );
+    return true;
+  }
+
+  // Same layout as InMemoryDetectionDb, so the files are interchangeable
+
+  void to_json(json& j, const FrameIndexedDetectionDb& p) {
+    j = {};
+
+    json detections = {};
+    p.forEach( [&]( int frame, const Detection &det ) {
+      detections[ DetectionDb::FrameToKey(frame) ] = det;
+    });
+
+    j["detections"] = detections;
+  }
+
+  void from_json(const json& j, FrameIndexedDetectionDb& db) {
+    db = FrameIndexedDetectionDb();
+
+    if( j.count("detections") ) {
+      json jdet = j["detections"];
+      for (json::const_iterator det = jdet.begin(); det != jdet.end(); ++det) {
+        int frame;
+        if( !DetectionDb::KeyToFrame( det.key(), frame ) ) {
+          LOG(WARNING) << "Skipping non-integer key " << det.key();
+          continue;
+        }
+
+        Detection detection = det.value();
+        db.insertFrame( frame, detection );
+      }
+    }
+  }
+
+  //======
+
+  struct SharedWithBody : public cv::ParallelLoopBody {
+    SharedWithBody( const vector< const Detection * > &a, const vector< const Detection * > &b,
+                    vector< SharedPoints > &shared )
+      : _a( a ), _b( b ), _shared( shared )
+    {;}
+
+    virtual void operator()( const cv::Range &r ) const
+    {
+      for( int i = r.start; i < r.end; ++i )
+        if( _a[i] && _b[i] ) _shared[i] = Detection::sharedWith( *_a[i], *_b[i] );
+    }
+
+    const vector< const Detection * > &_a, &_b;
+    vector< SharedPoints > &_shared;
+  };
+
+  static void sharedWith( const vector< const Detection * > &a, const vector< const Detection * > &b,
+                          vector< SharedPoints > &shared )
+  {
+    shared.assign( a.size(), SharedPoints() );
+    cv::parallel_for_( cv::Range( 0, (int)a.size() ), SharedWithBody( a, b, shared ) );
+  }
+
+  void sharedWith( DetectionDb &a, DetectionDb &b, const vector<int> &frames,
+                   vector< SharedPoints > &shared )
+  {
+    // Hold on to the shared_ptrs while the pointers are in use
+    vector< std::shared_ptr<Detection> > heldA( frames.size() ), heldB( frames.size() );
+    vector< const Detection * > detA( frames.size(), NULL ), detB( frames.size(), NULL );
+
+    for( size_t i = 0; i < frames.size(); ++i ) {
+      heldA[i] = a.atFrame( frames[i] );
+      heldB[i] = b.atFrame( frames[i] );
+      detA[i] = heldA[i].get();
+      detB[i] = heldB[i].get();
+    }
+
+    sharedWith( detA, detB, shared );
+  }
+
+  void sharedWith( const FrameIndexedDetectionDb &a, const FrameIndexedDetectionDb &b,
+                   vector<int> &frames, vector< SharedPoints > &shared )
+  {
+    vector< const Detection * > detA, detB;
+    frames.clear();
+
+    const size_t end = std::min( a.endFrame(), b.endFrame() );
+    for( size_t i = 0; i < end; ++i ) {
+      if( a.has(i) && b.has(i) ) {
+        frames.push_back( i );
+        detA.push_back( a.find(i) );
+        detB.push_back( b.find(i) );
+      }
+    }
+
+    sharedWith( detA, detB, shared );
+  }
+
 }
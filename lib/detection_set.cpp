@@ -3,23 +3,56 @@
 
 namespace AplCam {
 
+  DetectionSet::~DetectionSet( void )
+  {
+    for( size_t i = 0; i < _pending.size(); ++i ) delete _pending[i];
+  }
 
-  static bool RemoveIfNoValidate( Detection *det )
+  void DetectionSet::addDetection( Detection *detection, const int frame )
   {
-    return det->validate() < 0;
+    if( !detection ) return;
+
+    _flat.add( *detection, frame );
+    _pending.push_back( detection );
+  }
+
+  void DetectionSet::addDetection( const Detection &detection, const int frame )
+  {
+    _flat.add( detection, frame );
+    _pending.push_back( NULL );
+  }
+
+  void DetectionSet::addDetection( const DetectionView &view )
+  {
+    _flat.add( view );
+    _pending.push_back( NULL );
   }
 
   int DetectionSet::validate( void )
   {
-    DetectionMap::iterator newEnd = std::remove_if( _detections.begin(), _detections.end(), RemoveIfNoValidate );
+    if( std::count( _pending.begin(), _pending.end(), (Detection *)NULL ) == (int)_pending.size() )
+      return size();
 
-    int newSize = 0;
-    for( DetectionMap::iterator itr = _detections.begin(); itr != newEnd; ++newSize, ++itr ) {;}
+    // validate() may drop points as well as reject the frame, so rebuild
+    // the flat storage from the results
+    FlatDetections validated;
+    validated.reserve( _flat.size(), _flat.totalPoints() );
 
-    _detections.resize( newSize );
+    for( size_t i = 0; i < _flat.size(); ++i ) {
+      Detection *det = _pending[i];
 
-    return size();
+      if( det == NULL )
+        validated.add( _flat[i] );
+      else if( det->validate() >= 0 )
+        validated.add( *det, _flat.frame(i) );
 
+      delete det;
+    }
+
+    _flat = validated;
+    _pending.assign( _flat.size(), NULL );
+
+    return size();
   }
 
 }
@@ -46,6 +46,7 @@ namespace Distortion {
     }
 
     doCalibrate( objectPoints, imagePoints, image_size, result, flags, criteria );
+    coefficientsChanged();
 
     return result.good;
   }
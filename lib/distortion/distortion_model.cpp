@@ -5,6 +5,8 @@ using namespace std;
 #include <opencv2/core/affine.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 
+#include <glog/logging.h>
+
 #include "AplCam/distortion/distortion_model.h"
 #include "AplCam/distortion/angular_polynomial.h"
 #include "AplCam/distortion/radial_polynomial.h"
@@ -98,6 +100,61 @@ namespace Distortion {
   }
 
 
+  //--- Undistortion lookup table ---
+
+  void DistortionModel::buildUndistortionTable( const Size &imageSize, int step,
+                                                UndistortionTable::Interpolation interp )
+  {
+    _undistortionTable.reset( new UndistortionTable( *this, imageSize, step, interp ) );
+
+    LOG(INFO) << "Built " << imageSize.width << "x" << imageSize.height
+              << " undistortion table with step " << step << ", max error "
+              << _undistortionTable->maxError() * favg() << " pixels";
+  }
+
+  const UndistortionTable *DistortionModel::undistortionTable( void ) const
+  {
+    if( !_undistortionTable ) return NULL;
+    if( _undistortionTable->version() != coefficientsVersion() ) return NULL;
+    return _undistortionTable.get();
+  }
+
+  ImagePoint DistortionModel::normalizeUndistort( const ImagePoint &pw ) const
+  {
+    const UndistortionTable *table = undistortionTable();
+    ImagePoint out;
+
+    if( table && table->lookup( pw, out ) ) return out;
+
+    return PinholeCamera::normalizeUndistort( pw );
+  }
+
+  ImagePointsVec DistortionModel::normalizeUndistort( const ImagePointsVec &pw ) const
+  {
+    const UndistortionTable *table = undistortionTable();
+    if( !table ) return PinholeCamera::normalizeUndistort( pw );
+
+    ImagePointsVec out( pw.size() );
+
+    // Anything which misses the table is solved exactly, as one batch
+    vector< size_t > missIdx;
+    ImagePointsVec misses;
+    for( size_t i = 0; i < pw.size(); ++i ) {
+      if( !table->lookup( pw[i], out[i] ) ) {
+        missIdx.push_back( i );
+        misses.push_back( pw[i] );
+      }
+    }
+
+    if( !misses.empty() ) {
+      ImagePointsVec solved( PinholeCamera::normalizeUndistort( misses ) );
+      for( size_t i = 0; i < missIdx.size(); ++i ) out[ missIdx[i] ] = solved[i];
+    }
+
+    return out;
+  }
+
+
 
 
 
@@ -16,6 +16,41 @@ namespace Distortion {
   using namespace cv;
   using namespace std;
 
+  struct UndistortImagePairBody : public ParallelLoopBody {
+    UndistortImagePairBody( const PinholeCamera &cam1, const PinholeCamera &cam2,
+                            const ImagePointsVecVec &in1, const ImagePointsVecVec &in2,
+                            ImagePointsVecVec &out1, ImagePointsVecVec &out2 )
+      : _cam1( cam1 ), _cam2( cam2 ), _in1( in1 ), _in2( in2 ), _out1( out1 ), _out2( out2 )
+    {;}
+
+    // Index i < n is view i of camera 1, otherwise view (i-n) of camera 2
+    virtual void operator()( const Range &r ) const
+    {
+      const int n = _in1.size();
+      for( int i = r.start; i < r.end; ++i ) {
+        if( i < n ) _out1[i]   = _cam1.normalizeUndistortImage( _in1[i] );
+        else        _out2[i-n] = _cam2.normalizeUndistortImage( _in2[i-n] );
+      }
+    }
+
+    const PinholeCamera &_cam1, &_cam2;
+    const ImagePointsVecVec &_in1, &_in2;
+    ImagePointsVecVec &_out1, &_out2;
+  };
+
+  void normalizeUndistortImagePair( const PinholeCamera &cam1, const PinholeCamera &cam2,
+                                    const ImagePointsVecVec &imagePoints1,
+                                    const ImagePointsVecVec &imagePoints2,
+                                    ImagePointsVecVec &undistorted1,
+                                    ImagePointsVecVec &undistorted2 )
+  {
+    undistorted1.resize( imagePoints1.size() );
+    undistorted2.resize( imagePoints2.size() );
+
+    parallel_for_( Range( 0, (int)(imagePoints1.size() + imagePoints2.size()) ),
+                   UndistortImagePairBody( cam1, cam2, imagePoints1, imagePoints2, undistorted1, undistorted2 ) );
+  }
+
   double stereoCalibrate( ObjectPointsVecVec _objectPoints,
       ImagePointsVecVec _imagePoints1,
       ImagePointsVecVec _imagePoints2,
@@ -28,8 +63,8 @@ namespace Distortion {
     // Before I get too involved, what if I just un-distort all image points
     // then call the built-in function?
 
-    ImagePointsVecVec _undistorted1( cam1.normalizeUndistortImage( _imagePoints1 ) ),
-                      _undistorted2( cam2.normalizeUndistortImage( _imagePoints1 ) );
+    ImagePointsVecVec _undistorted1, _undistorted2;
+    normalizeUndistortImagePair( cam1, cam2, _imagePoints1, _imagePoints2, _undistorted1, _undistorted2 );
 
     // These might be changed by the calibration.
     Mat camMat1( cam1.mat() );
@@ -843,34 +878,88 @@ double rms = cv::stereoCalibrate( _objectPoints, _undistorted1, _undistorted2,
       ObjectPointsVec &worldPoints )
 
   {
-    // Need to generate projection matrices for the two cameras
-    //
-    // As we're using normalized points, should be [ I | 0 ] and [ R | t ]
+    const size_t count = std::min( imagePoints1.size(), imagePoints2.size() );
 
-    Mat proj1( Mat::eye(3,4, CV_32F) ), proj2( 3,4, CV_32F );
+    vector< Vec3d > triPts( count );
+    if( count > 0 )
+      triangulate( cam1, cam2, calib, &(imagePoints1[0]), &(imagePoints2[0]), count, &(triPts[0]) );
 
-    Mat rRoi( proj2, Rect(0,0,3,3) );
-    calib.R.convertTo( rRoi, CV_32F );
-    Mat tRoi( proj2, Rect(3,0,1,3) );
-    calib.t.convertTo( tRoi, CV_32F );
+    worldPoints.resize( count );
+    for( size_t i = 0; i < count; i++ )
+      worldPoints[i] = ObjectPoint( triPts[i][0], triPts[i][1], triPts[i][2] );
 
-    Mat triPts;
-
-    ImagePointsVec undistorted1 = cam1.normalizeUndistort( imagePoints1 ),
-                   undistorted2 = cam2.normalizeUndistort( imagePoints2 );
+    // TODO:  How to detect failure?
+    return true;
+  }
 
-    cv::triangulatePoints( proj1, proj2, undistorted1, undistorted2, triPts );
+  struct TriangulateBody : public ParallelLoopBody {
+    TriangulateBody( const PinholeCamera &cam1, const PinholeCamera &cam2,
+                     const Matx33d &R, const Vec3d &t,
+                     const ImagePoint *pts1, const ImagePoint *pts2, Vec3d *out )
+      : _cam1( cam1 ), _cam2( cam2 ), _R( R ), _t( t ), _pts1( pts1 ), _pts2( pts2 ), _out( out )
+    {;}
 
-    // Translate un-homogenize triPts into worldPts
-    worldPoints.clear();
-    for( int i = 0; i < triPts.cols; i++ ) {
-      worldPoints.push_back (ObjectPoint(  triPts.at<float>( 0, i ) / triPts.at<float>( 3, i ),
-                    triPts.at<float>( 1, i ) / triPts.at<float>( 3, i ),
-                    triPts.at<float>( 2, i ) / triPts.at<float>( 3, i ) ));
+    virtual void operator()( const Range &r ) const
+    {
+      // Undistort this slice as a batch
+      ImagePointsVec undist1( _cam1.normalizeUndistort( ImagePointsVec( _pts1 + r.start, _pts1 + r.end ) ) ),
+                     undist2( _cam2.normalizeUndistort( ImagePointsVec( _pts2 + r.start, _pts2 + r.end ) ) );
+
+      // As we're using normalized points, the projection matrices are
+      // [ I | 0 ] and [ R | t ].  Each view contributes two rows to
+      // A X = b;  solve the normal equations directly.
+      const Vec3d r1( _R(0,0), _R(0,1), _R(0,2) ),
+                  r2( _R(1,0), _R(1,1), _R(1,2) ),
+                  r3( _R(2,0), _R(2,1), _R(2,2) );
+
+      for( int i = r.start; i < r.end; ++i ) {
+        const int j = i - r.start;
+        const double u1 = undist1[j][0], v1 = undist1[j][1],
+                     u2 = undist2[j][0], v2 = undist2[j][1];
+
+        const Vec3d a[4] = { Vec3d( 1, 0, -u1 ),
+                             Vec3d( 0, 1, -v1 ),
+                             u2*r3 - r1,
+                             v2*r3 - r2 };
+        const double b[4] = { 0, 0, _t[0] - u2*_t[2], _t[1] - v2*_t[2] };
+
+        Matx33d AtA( Matx33d::zeros() );
+        Vec3d Atb( 0, 0, 0 );
+        for( int k = 0; k < 4; ++k ) {
+          AtA += a[k] * a[k].t();
+          Atb += a[k] * b[k];
+        }
+
+        _out[i] = AtA.solve( Atb, DECOMP_CHOLESKY );
+      }
     }
 
-    // TODO:  How to detect failure?
-    return true;
+    const PinholeCamera &_cam1, &_cam2;
+    const Matx33d _R;
+    const Vec3d _t;
+    const ImagePoint *_pts1, *_pts2;
+    Vec3d *_out;
+  };
+
+  void triangulate( const PinholeCamera &cam1, const PinholeCamera &cam2,
+                    const StereoCalibration &calib,
+                    const ImagePoint *imagePoints1,
+                    const ImagePoint *imagePoints2,
+                    size_t count,
+                    Vec3d *worldPoints )
+  {
+    if( count == 0 ) return;
+
+    Matx33d R;
+    Vec3d t;
+    calib.R.convertTo( R, CV_64F );
+    calib.t.convertTo( t, CV_64F );
+
+    // Slices of a few hundred points keep the batch undistortion efficient
+    const int sliceSize = 256;
+    parallel_for_( Range( 0, (int)count ),
+                   TriangulateBody( cam1, cam2, R, t, imagePoints1, imagePoints2, worldPoints ),
+                   (count + sliceSize - 1) / sliceSize );
   }
 
 
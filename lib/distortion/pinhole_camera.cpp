@@ -6,6 +6,7 @@
 #include <glog/logging.h>
 
 #include "AplCam/distortion/pinhole_camera.h"
+#include "AplCam/detection/flat_detections.h"
 
 namespace Distortion {
 
@@ -51,6 +52,8 @@ namespace Distortion {
     _cx = cx;
     _cy = cy;
     _alpha = alpha;
+
+    coefficientsChanged();
   }
 
   void PinholeCamera::setCamera( const double *c, double alpha )
@@ -435,6 +438,32 @@ namespace Distortion {
     return sqrt(rms/numPoints);
   }
 
+  double PinholeCamera::reprojectionError( const FlatDetections &detections,
+                                             const RotVec &rvecs,
+                                             const TransVec &tvecs,
+                                             const vector<bool> mask )
+  {
+    int numPoints = 0;
+    double rms = 0.0;
+
+    for( size_t j = 0; j < detections.size(); ++j ) {
+      if( !mask.empty() && mask[j] == false ) continue;
+
+      const DetectionView det( detections[j] );
+      numPoints += det.size();
+
+      for( size_t k = 0; k < det.size(); ++k ) {
+        ImagePoint projPt;
+        projectPoint( det.corners[k], rvecs[j], tvecs[j], projPt );
+
+        const ImagePoint err( projPt - det.points[k] );
+        rms += err.dot( err );
+      }
+    }
+
+    return sqrt(rms/numPoints);
+  }
+
 
 
  // --- Serialization/unserialization functions ----
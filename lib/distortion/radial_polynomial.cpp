@@ -23,38 +23,46 @@ namespace Distortion {
   using namespace std;
 
   RadialPolynomial::RadialPolynomial( void )
-  : DistortionModel(),  _distCoeffs( 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 )
+  : DistortionModel(),  _distCoeffs( 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 ),
+    _undistortCriteria( DefaultUndistortCriteria() )
   {;}
 
   RadialPolynomial::RadialPolynomial( const Vec4d &d )
-  : DistortionModel(),  _distCoeffs( d[0], d[1], d[2], d[3], 0., 0., 0., 0. )
+  : DistortionModel(),  _distCoeffs( d[0], d[1], d[2], d[3], 0., 0., 0., 0. ),
+    _undistortCriteria( DefaultUndistortCriteria() )
   {;}
 
   RadialPolynomial::RadialPolynomial( const Vec5d &d )
-  : DistortionModel(),  _distCoeffs( d[0], d[1], d[2], d[3], d[4], 0., 0., 0. )
+  : DistortionModel(),  _distCoeffs( d[0], d[1], d[2], d[3], d[4], 0., 0., 0. ),
+    _undistortCriteria( DefaultUndistortCriteria() )
   {;}
 
   RadialPolynomial::RadialPolynomial( const Vec8d &distCoeffs )
-  : DistortionModel(),  _distCoeffs( distCoeffs )
+  : DistortionModel(),  _distCoeffs( distCoeffs ),
+    _undistortCriteria( DefaultUndistortCriteria() )
   {;}
 
   RadialPolynomial::RadialPolynomial( const Vec12d &coeffs)
   : DistortionModel( Vec4d( coeffs[0], coeffs[1], coeffs[2], coeffs[3] ) ),
   _distCoeffs( Vec8d( coeffs[4], coeffs[5], coeffs[6], coeffs[7], coeffs[8],
-    coeffs[9], coeffs[10], coeffs[11] ) )
+    coeffs[9], coeffs[10], coeffs[11] ) ),
+  _undistortCriteria( DefaultUndistortCriteria() )
     {;}
 
 
     RadialPolynomial::RadialPolynomial( const Vec4d &d, const Matx33d &cam )
-    : DistortionModel( cam ),    _distCoeffs( d[0], d[1], d[2], d[3], 0., 0., 0., 0. )
+    : DistortionModel( cam ),    _distCoeffs( d[0], d[1], d[2], d[3], 0., 0., 0., 0. ),
+      _undistortCriteria( DefaultUndistortCriteria() )
     {;}
 
     RadialPolynomial::RadialPolynomial( const Vec5d &d, const Matx33d &cam )
-    : DistortionModel( cam ),    _distCoeffs( d[0], d[1], d[2], d[3], d[4], 0., 0., 0. )
+    : DistortionModel( cam ),    _distCoeffs( d[0], d[1], d[2], d[3], d[4], 0., 0., 0. ),
+      _undistortCriteria( DefaultUndistortCriteria() )
     {;}
 
     RadialPolynomial::RadialPolynomial( const Vec8d &distCoeffs, const Matx33d &cam )
-    : DistortionModel( cam ),    _distCoeffs( distCoeffs )
+    : DistortionModel( cam ),    _distCoeffs( distCoeffs ),
+      _undistortCriteria( DefaultUndistortCriteria() )
     {;}
 
     //--- Accessor functions ----
@@ -127,12 +135,72 @@ namespace Distortion {
 
         ImagePoint RadialPolynomial::undistort( const ImagePoint &pw ) const
         {
-          vector<ImagePoint> inVec, outVec(1);
-          inVec.push_back(pw);
+          ImagePoint out;
+          undistortArray( &pw, &out, 1 );
+          return out;
+        }
 
-          cv::undistortPoints( inVec, outVec, Mat::eye(3,3,CV_64F), Mat(_distCoeffs) );
+        ImagePointsVec RadialPolynomial::undistortVec( const ImagePointsVec &pw ) const
+        {
+          ImagePointsVec out( pw.size() );
+          if( !pw.empty() ) undistortArray( &(pw[0]), &(out[0]), pw.size() );
+          return out;
+        }
 
-          return outVec.front();
+        // Same fixed-point iteration as cv::undistortPoints, but run over
+        // blocks of points held in plain double arrays so the inner loops
+        // are branch-free and can be vectorized by the compiler.  The
+        // convergence check is done once per pass over a block.
+        void RadialPolynomial::undistortArray( const ImagePoint *in, ImagePoint *out, size_t n ) const
+        {
+          const int BlockSize = 64;
+
+          const double k1 = _distCoeffs[0], k2 = _distCoeffs[1], p1 = _distCoeffs[2],
+                p2 = _distCoeffs[3], k3 = _distCoeffs[4], k4 = _distCoeffs[5],
+                k5 = _distCoeffs[6], k6 = _distCoeffs[7];
+
+          const int maxIter = (_undistortCriteria.type & TermCriteria::COUNT) ? _undistortCriteria.maxCount : 5;
+          const bool checkEps = (_undistortCriteria.type & TermCriteria::EPS) && _undistortCriteria.epsilon > 0;
+          const double eps2 = _undistortCriteria.epsilon * _undistortCriteria.epsilon;
+
+          double x0[BlockSize], y0[BlockSize], x[BlockSize], y[BlockSize];
+
+          for( size_t start = 0; start < n; start += BlockSize ) {
+            const int len = std::min( (size_t)BlockSize, n - start );
+
+            for( int i = 0; i < len; ++i ) {
+              x[i] = x0[i] = in[start+i][0];
+              y[i] = y0[i] = in[start+i][1];
+            }
+
+            for( int iter = 0; iter < maxIter; ++iter ) {
+              for( int i = 0; i < len; ++i ) {
+                const double r2 = x[i]*x[i] + y[i]*y[i];
+                const double icdist = (1 + ((k6*r2 + k5)*r2 + k4)*r2) / (1 + ((k3*r2 + k2)*r2 + k1)*r2);
+                const double deltaX = 2*p1*x[i]*y[i] + p2*(r2 + 2*x[i]*x[i]);
+                const double deltaY = p1*(r2 + 2*y[i]*y[i]) + 2*p2*x[i]*y[i];
+                x[i] = (x0[i] - deltaX)*icdist;
+                y[i] = (y0[i] - deltaY)*icdist;
+              }
+
+              if( !checkEps ) continue;
+
+              // Re-distort the current estimate and compare to the input
+              double maxErr2 = 0;
+              for( int i = 0; i < len; ++i ) {
+                const double r2 = x[i]*x[i] + y[i]*y[i];
+                const double cdist = (1 + ((k3*r2 + k2)*r2 + k1)*r2) / (1 + ((k6*r2 + k5)*r2 + k4)*r2);
+                const double ex = x[i]*cdist + 2*p1*x[i]*y[i] + p2*(r2 + 2*x[i]*x[i]) - x0[i];
+                const double ey = y[i]*cdist + p1*(r2 + 2*y[i]*y[i]) + 2*p2*x[i]*y[i] - y0[i];
+                maxErr2 = std::max( maxErr2, ex*ex + ey*ey );
+              }
+
+              if( maxErr2 < eps2 ) break;
+            }
+
+            for( int i = 0; i < len; ++i )
+              out[start+i] = ImagePoint( x[i], y[i] );
+          }
         }
 
 
@@ -3,8 +3,10 @@
 #include <iomanip>
 
 #include <opencv2/calib3d/calib3d.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
 
 #include "AplCam/stereo_calibration.h"
+#include "AplCam/distortion/distortion_model.h"
 
 
 namespace AplCam {
@@ -146,7 +148,64 @@ namespace AplCam {
         StereoRectification::rect1Tag = "rectification_1",
         StereoRectification::proj0Tag = "projection_0",
         StereoRectification::proj1Tag = "projection_1",
-        StereoRectification::qTag = "disparity_mapping";
+        StereoRectification::qTag = "disparity_mapping",
+        StereoRectification::map1_0Tag = "rectify_map1_0",
+        StereoRectification::map1_1Tag = "rectify_map1_1",
+        StereoRectification::map2_0Tag = "rectify_map2_0",
+        StereoRectification::map2_1Tag = "rectify_map2_1";
+
+  struct InitRectifyMapsBody : public ParallelLoopBody {
+    InitRectifyMapsBody( StereoRectification &rect, Distortion::DistortionModel *cams[2], const Size &imageSize )
+      : _rect( rect ), _imageSize( imageSize )
+    { _cams[0] = cams[0];  _cams[1] = cams[1]; }
+
+    virtual void operator()( const Range &r ) const
+    {
+      for( int i = r.start; i < r.end; ++i )
+        _cams[i]->initUndistortRectifyMap( _rect.R[i], _rect.P[i], _imageSize, CV_16SC2,
+                                           _rect.map1[i], _rect.map2[i] );
+    }
+
+    StereoRectification &_rect;
+    Distortion::DistortionModel *_cams[2];
+    Size _imageSize;
+  };
+
+  void StereoRectification::initMaps( Distortion::DistortionModel &cam0, Distortion::DistortionModel &cam1,
+                                      const Size &imageSize )
+  {
+    CV_Assert( isInitialized() );
+
+    Distortion::DistortionModel *cams[2] = { &cam0, &cam1 };
+    parallel_for_( Range( 0, 2 ), InitRectifyMapsBody( *this, cams, imageSize ) );
+  }
+
+  struct RectifyCanvasBody : public ParallelLoopBody {
+    RectifyCanvasBody( const StereoRectification &rect, CompositeCanvas &canvas )
+      : _rect( rect ), _canvas( canvas )
+    {;}
+
+    virtual void operator()( const Range &r ) const
+    {
+      for( int i = r.start; i < r.end; ++i ) {
+        // remap can't work in place
+        Mat rectified;
+        remap( _canvas[i], rectified, _rect.map1[i], _rect.map2[i], INTER_LINEAR, BORDER_CONSTANT );
+        rectified.copyTo( _canvas[i] );
+      }
+    }
+
+    const StereoRectification &_rect;
+    CompositeCanvas &_canvas;
+  };
+
+  void StereoRectification::rectify( CompositeCanvas &canvas ) const
+  {
+    CV_Assert( hasMaps() );
+    CV_Assert( canvas[0].size() == map1[0].size() && canvas[1].size() == map1[1].size() );
+
+    parallel_for_( Range( 0, 2 ), RectifyCanvasBody( *this, canvas ) );
+  }
 
   void StereoRectification::save( FileStorage &fs ) const
   {
@@ -157,6 +216,13 @@ namespace AplCam {
     fs << proj1Tag << P[1];
 
     fs << qTag << Q;
+
+    if( hasMaps() ) {
+      fs << map1_0Tag << map1[0];
+      fs << map1_1Tag << map1[1];
+      fs << map2_0Tag << map2[0];
+      fs << map2_1Tag << map2[1];
+    }
   }
 
 
@@ -168,6 +234,12 @@ namespace AplCam {
     fs[ proj1Tag ] >> P[1];
     fs[ qTag ] >> Q;
 
+    // Maps are optional;  if absent, call initMaps()
+    fs[ map1_0Tag ] >> map1[0];
+    fs[ map1_1Tag ] >> map1[1];
+    fs[ map2_0Tag ] >> map2[0];
+    fs[ map2_1Tag ] >> map2[1];
+
     if( R[0].empty() || R[1].empty() || P[0].empty() || P[1].empty() || Q.empty() ) return false;
 
     return true;
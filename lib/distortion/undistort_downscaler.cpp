@@ -0,0 +1,156 @@
+
+#include <math.h>
+#include <climits>
+#include <algorithm>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "AplCam/distortion/undistort_downscaler.h"
+
+namespace Distortion {
+
+  using namespace cv;
+
+  // Fixed-point BGR->gray, same coefficients as cvtColor
+  static const int GrayShift = 14;
+  static const int GrayB = 1868, GrayG = 9617, GrayR = 4899;
+
+  static inline int toGray( const uchar *p, int cn )
+  {
+    if( cn == 1 ) return p[0];
+    return (p[0]*GrayB + p[1]*GrayG + p[2]*GrayR + (1 << (GrayShift-1))) >> GrayShift;
+  }
+
+  // Camera matrix for an image scaled by s, keeping pixel centers aligned
+  static Matx33d scaleCamera( const PinholeCamera &cam, double s )
+  {
+    return Matx33d( cam.fx()*s, cam.alpha()*cam.fx()*s, (cam.cx()+0.5)*s - 0.5,
+                    0, cam.fy()*s, (cam.cy()+0.5)*s - 0.5,
+                    0, 0, 1 );
+  }
+
+  UndistortDownscaler::UndistortDownscaler( DistortionModel &cam, const Size &srcSize, double scale )
+    : _srcSize( srcSize ),
+      _dstSize( cvRound( srcSize.width * scale ), cvRound( srcSize.height * scale ) ),
+      _scale( scale ),
+      _samples( scale <= 0.5 ? 4 : 1 ),
+      _K( scaleCamera( cam, scale ) )
+  {
+    CV_Assert( scale > 0 && _dstSize.area() > 0 );
+    CV_Assert( srcSize.width < SHRT_MAX && srcSize.height < SHRT_MAX );
+
+    // With supersampling, build the map at twice the output resolution;
+    // output pixel (u,v) then averages map entries (2u..2u+1, 2v..2v+1)
+    const int sub = (_samples == 4) ? 2 : 1;
+    Size mapSize( _dstSize.width * sub, _dstSize.height * sub );
+
+    Mat mapx, mapy;
+    cam.initUndistortRectifyMap( Mat(), Mat( scaleCamera( cam, scale*sub ) ), mapSize, CV_32FC1, mapx, mapy );
+
+    _taps.resize( _dstSize.area() * _samples );
+
+    for( int v = 0; v < _dstSize.height; ++v ) {
+      for( int u = 0; u < _dstSize.width; ++u ) {
+        Tap *tap = &_taps[ (v*_dstSize.width + u) * _samples ];
+
+        for( int j = 0; j < sub; ++j ) {
+          const float *mx = mapx.ptr<float>( v*sub + j ), *my = mapy.ptr<float>( v*sub + j );
+
+          for( int i = 0; i < sub; ++i, ++tap ) {
+            const float x = mx[ u*sub + i ], y = my[ u*sub + i ];
+
+            *tap = MakeTap( x, y, _srcSize );
+          }
+        }
+      }
+    }
+  }
+
+  UndistortDownscaler::Tap UndistortDownscaler::MakeTap( float x, float y, const Size &srcSize )
+  {
+    Tap tap;
+
+    if( !( x >= 0 && y >= 0 && x <= srcSize.width-1 && y <= srcSize.height-1 ) ||
+        srcSize.width < 2 || srcSize.height < 2 ) {
+      tap.x = tap.y = -1;
+      tap.w[0] = tap.w[1] = tap.w[2] = tap.w[3] = 0;
+      return tap;
+    }
+
+    // On the last column/row, use the pair to its left/above with full
+    // weight on the right/bottom so p0+cn and p1 stay in the image
+    const int ix = std::min( (int)x, srcSize.width-2 ),
+              iy = std::min( (int)y, srcSize.height-2 );
+
+    // Rounded 1-D weights, then split each row's weight between its two
+    // columns.  Every weight is non-negative and they sum to exactly one.
+    const int one = 1 << WeightBits;
+    const int bottom = std::min( one, std::max( 0, cvRound( (y - iy) * one ) ) ), top = one - bottom;
+    const int right  = std::min( one, std::max( 0, cvRound( (x - ix) * one ) ) ), left = one - right;
+
+    tap.x = ix;
+    tap.y = iy;
+    tap.w[0] = (top * left + (one >> 1)) >> WeightBits;
+    tap.w[1] = top - tap.w[0];
+    tap.w[2] = (bottom * left + (one >> 1)) >> WeightBits;
+    tap.w[3] = bottom - tap.w[2];
+
+    return tap;
+  }
+
+  struct UndistortDownscaleBody : public ParallelLoopBody {
+    UndistortDownscaleBody( const Mat &src, Mat &dst,
+                            const vector< UndistortDownscaler::Tap > &taps, int samples )
+      : _src( src ), _dst( dst ), _taps( taps ), _samples( samples )
+    {;}
+
+    virtual void operator()( const Range &rows ) const
+    {
+      const int cn = _src.channels();
+      const size_t step = _src.step;
+
+      // Weights are WeightBits, plus the average over _samples taps
+      const int shift = UndistortDownscaler::WeightBits + (_samples == 4 ? 2 : 0);
+      const int round = 1 << (shift-1);
+
+      for( int v = rows.start; v < rows.end; ++v ) {
+        uchar *out = _dst.ptr<uchar>(v);
+        const UndistortDownscaler::Tap *tap = &_taps[ v * _dst.cols * _samples ];
+
+        for( int u = 0; u < _dst.cols; ++u ) {
+          int acc = 0;
+
+          for( int s = 0; s < _samples; ++s, ++tap ) {
+            if( tap->x < 0 ) continue;
+
+            const uchar *p0 = _src.data + tap->y*step + tap->x*cn;
+            const uchar *p1 = p0 + step;
+
+            acc += toGray( p0, cn )    * tap->w[0] + toGray( p0+cn, cn ) * tap->w[1] +
+                   toGray( p1, cn )    * tap->w[2] + toGray( p1+cn, cn ) * tap->w[3];
+          }
+
+          out[u] = (uchar)( (acc + round) >> shift );
+        }
+      }
+    }
+
+    const Mat &_src;
+    Mat &_dst;
+    const vector< UndistortDownscaler::Tap > &_taps;
+    int _samples;
+  };
+
+  void UndistortDownscaler::apply( const Mat &src, Mat &gray ) const
+  {
+    CV_Assert( src.depth() == CV_8U && (src.channels() == 1 || src.channels() == 3 || src.channels() == 4) );
+    CV_Assert( src.size() == _srcSize );
+
+    // Don't write over our own input
+    if( gray.data == src.data ) gray.release();
+    gray.create( _dstSize, CV_8UC1 );
+
+    parallel_for_( Range( 0, _dstSize.height ), UndistortDownscaleBody( src, gray, _taps, _samples ) );
+  }
+
+}
@@ -0,0 +1,120 @@
+
+#include <math.h>
+
+#include "AplCam/distortion/undistortion_table.h"
+#include "AplCam/distortion/pinhole_camera.h"
+
+namespace Distortion {
+
+  UndistortionTable::UndistortionTable( const PinholeCamera &cam, const Size &imageSize,
+                                        int step, Interpolation interp )
+    : _imageSize( imageSize ), _step( std::max( step, 1 ) ), _interp( interp ),
+      _version( cam.coefficientsVersion() ),
+      _maxError( 0.0 ), _rmsError( 0.0 )
+  {
+    // Nodes run from 0 to at least (width-1, height-1)
+    _cols = (std::max( _imageSize.width-1, 1) + _step - 1)/_step + 1;
+    _rows = (std::max( _imageSize.height-1, 1) + _step - 1)/_step + 1;
+
+    ImagePointsVec grid;
+    grid.reserve( _cols * _rows );
+    for( int y = 0; y < _rows; ++y )
+      for( int x = 0; x < _cols; ++x )
+        grid.push_back( ImagePoint( x*_step, y*_step ) );
+
+    // Call the PinholeCamera version explicitly so we always get the
+    // exact solution, never a (possibly stale) table
+    ImagePointsVec undist( cam.PinholeCamera::normalizeUndistort( grid ) );
+
+    _nodes.resize( undist.size() );
+    for( size_t i = 0; i < undist.size(); ++i )
+      _nodes[i] = Vec2d( undist[i][0], undist[i][1] );
+
+    estimateError( cam );
+  }
+
+  bool UndistortionTable::lookup( const ImagePoint &pixel, ImagePoint &out ) const
+  {
+    const double gx = pixel[0] / _step, gy = pixel[1] / _step;
+
+    if( !(gx >= 0 && gy >= 0 && gx <= _cols-1 && gy <= _rows-1) ) return false;
+
+    // Points on the last row/column interpolate within the last cell
+    const int x = std::min( (int)gx, _cols-2 ), y = std::min( (int)gy, _rows-2 );
+
+    out = (_interp == BICUBIC) ? bicubic( x, y, gx-x, gy-y ) : bilinear( x, y, gx-x, gy-y );
+    return true;
+  }
+
+  ImagePoint UndistortionTable::bilinear( int x, int y, double fx, double fy ) const
+  {
+    const Vec2d &a = node( x, y ),   &b = node( x+1, y ),
+                &c = node( x, y+1 ), &d = node( x+1, y+1 );
+
+    Vec2d top( a + (b-a)*fx ), bottom( c + (d-c)*fx );
+    Vec2d p( top + (bottom-top)*fy );
+
+    return ImagePoint( p[0], p[1] );
+  }
+
+  // Catmull-Rom spline, replicating nodes at the table boundaries
+  static inline void catmullRomWeights( double t, double w[4] )
+  {
+    const double t2 = t*t, t3 = t2*t;
+    w[0] = 0.5 * ( -t3 + 2*t2 - t );
+    w[1] = 0.5 * ( 3*t3 - 5*t2 + 2 );
+    w[2] = 0.5 * ( -3*t3 + 4*t2 + t );
+    w[3] = 0.5 * ( t3 - t2 );
+  }
+
+  ImagePoint UndistortionTable::bicubic( int x, int y, double fx, double fy ) const
+  {
+    double wx[4], wy[4];
+    catmullRomWeights( fx, wx );
+    catmullRomWeights( fy, wy );
+
+    Vec2d p( 0, 0 );
+    for( int j = 0; j < 4; ++j ) {
+      const int ny = std::min( std::max( y+j-1, 0 ), _rows-1 );
+
+      Vec2d row( 0, 0 );
+      for( int i = 0; i < 4; ++i ) {
+        const int nx = std::min( std::max( x+i-1, 0 ), _cols-1 );
+        row += node( nx, ny ) * wx[i];
+      }
+
+      p += row * wy[j];
+    }
+
+    return ImagePoint( p[0], p[1] );
+  }
+
+  void UndistortionTable::estimateError( const PinholeCamera &cam )
+  {
+    // Interpolation error is largest in the middle of each cell
+    ImagePointsVec centers;
+    centers.reserve( (_cols-1)*(_rows-1) );
+    for( int y = 0; y < _rows-1; ++y )
+      for( int x = 0; x < _cols-1; ++x )
+        centers.push_back( ImagePoint( (x+0.5)*_step, (y+0.5)*_step ) );
+
+    if( centers.empty() ) return;
+
+    ImagePointsVec exact( cam.PinholeCamera::normalizeUndistort( centers ) );
+
+    double sumSq = 0.0;
+    for( size_t i = 0; i < centers.size(); ++i ) {
+      ImagePoint interp;
+      if( !lookup( centers[i], interp ) ) continue;
+
+      const double err = cv::norm( interp - exact[i] );
+      if( err == err ) {
+        _maxError = std::max( _maxError, err );
+        sumSq += err*err;
+      }
+    }
+
+    _rmsError = sqrt( sumSq / centers.size() );
+  }
+
+}
@@ -137,8 +137,11 @@ namespace AplCam {
 
     cout << "From " << kps.size() << "/" << kpsInitially << " remain.  Added " << count << " dropped " << kpsTooClose << " as too close, " << kpsTooNearEdge << " too near edge, and dropped " << dropList.size() << " tracks for a total of " << _tracks.size() << endl;
 
-    // Maintain an archival copy
-    img.copyTo( _previous );
+    // Maintain an archival copy, always 8-bit
+    if( img.depth() == CV_32F )
+      img.convertTo( _previous, CV_8U, 255.0 );
+    else
+      img.copyTo( _previous );
   }
 
 
@@ -169,10 +172,19 @@ namespace AplCam {
 
   //===========================================================================
 
+  // Patches and search areas are matched as [0,1] floats
+  static void toFloat( const Mat &src, Mat &dst )
+  {
+    if( src.depth() == CV_32F )
+      src.copyTo( dst );
+    else
+      src.convertTo( dst, CV_32FC1, 1.0/255.0 );
+  }
+
   FeatureTracker::KeyPointTrack::KeyPointTrack( const Mat &patch, MotionModel *model )
     : _motionModel(model), _patch(), refeatured(5)
   {
-    patch.convertTo( _patch, CV_32FC1, 1.0/255.0 );
+    toFloat( patch, _patch );
   }
 
   FeatureTracker::KeyPointTrack::~KeyPointTrack( void )
@@ -183,8 +195,12 @@ namespace AplCam {
   bool FeatureTracker::KeyPointTrack::search( const Mat &roi, Point2f &match )
   {
     bool success = false;
+    // No copy needed if the frame is already float
     Mat roif;
-    roi.convertTo( roif, CV_32FC1, 1.0/255.0 );
+    if( roi.depth() == CV_32F )
+      roif = roi;
+    else
+      roi.convertTo( roif, CV_32FC1, 1.0/255.0 );
 
     if( roif.size().width < _patch.size().width ||
         roif.size().height < _patch.size().height ) return false;
@@ -208,7 +224,7 @@ namespace AplCam {
 
   void FeatureTracker::KeyPointTrack::update( const Mat &patch, const Point2f &position )
   {
-    patch.convertTo( _patch, CV_32FC1, 1.0/255.0 );
+    toFloat( patch, _patch );
 
     history.push_front( position );
     while( history.size() > MaxHistory ) history.pop_back();
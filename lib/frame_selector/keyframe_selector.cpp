@@ -1,24 +1,124 @@
+#include <algorithm>
+
 #include <opencv2/features2d/features2d.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/video/tracking.hpp>
 
 #include "AplCam/frame_selector/frame_selector.h"
 
 namespace AplCam {
 
+  using namespace cv;
+  using std::vector;
+
 
-  KeyframeSelector::KeyframeSelector( void )
+  KeyframeSelector::KeyframeSelector( const Params &params )
+    : _params( params ), _prevGray(), _kfPoints(), _trackedPoints(), _kfCount( 0 ),
+      _overlap( 0 ), _parallax( 0 )
   {;}
 
 
   bool KeyframeSelector::process( Mat &img )
   {
-    if( _kfKeyPoints.empty() ) {
-      FAST( img, _kfKeyPoints, true );
+    PreparedFrame frame( img );
+    return select( frame );
+  }
+
+  bool KeyframeSelector::select( PreparedFrame &frame )
+  {
+    Mat gray;
+    toWorking( frame, gray );
+
+    if( _prevGray.empty() ) {
+      setKeyframe( gray );
       return true;
     }
 
+    // Nothing to track in the last keyframe (blank or out-of-focus);
+    // don't select again until there is
+    if( _kfCount == 0 ) {
+      setKeyframe( gray );
+      return _kfCount > 0;
+    }
+
+    vector< Point2f > next;
+    vector< unsigned char > status;
+    vector< float > err;
+    calcOpticalFlowPyrLK( _prevGray, gray, _trackedPoints, next, status, err,
+                          Size( 15, 15 ), 2 );
 
+    // Drop lost points, keeping the keyframe/tracked pairs aligned
+    const Rect bounds( 0, 0, gray.cols, gray.rows );
+    vector< float > motion;
+    motion.reserve( next.size() );
 
+    size_t j = 0;
+    for( size_t i = 0; i < next.size(); ++i ) {
+      if( !status[i] || !bounds.contains( next[i] ) ) continue;
+
+      _kfPoints[j] = _kfPoints[i];
+      _trackedPoints[j] = next[i];
+
+      Point2f d( next[i] - _kfPoints[i] );
+      motion.push_back( d.x*d.x + d.y*d.y );
+      ++j;
+    }
+    _kfPoints.resize( j );
+    _trackedPoints.resize( j );
+
+    _overlap = float( j ) / _kfCount;
+
+    // Median displacement since the keyframe
+    if( !motion.empty() ) {
+      std::nth_element( motion.begin(), motion.begin() + motion.size()/2, motion.end() );
+      _parallax = sqrt( motion[ motion.size()/2 ] ) / sqrt( float( gray.cols*gray.cols + gray.rows*gray.rows ) );
+    }
+
+    if( j < (size_t)_params.minFeatures ||
+        _overlap < _params.minOverlap ||
+        _parallax > _params.maxParallax ) {
+      setKeyframe( gray );
+      return true;
+    }
+
+    _prevGray = gray;
     return false;
   }
 
+  void KeyframeSelector::toWorking( PreparedFrame &frame, Mat &gray ) const
+  {
+    // Start from the smallest pyramid level still wider than the working
+    // image;  the pyramid may well be shared with a detector
+    int level = 0;
+    if( _params.workingWidth > 0 ) {
+      const int cols = frame.gray().cols;
+      while( (cols >> (level+1)) >= _params.workingWidth ) ++level;
+    }
+
+    const Mat &g( frame.pyramid( level ) );
+
+    if( _params.workingWidth > 0 && g.cols > _params.workingWidth ) {
+      float scale = float( _params.workingWidth ) / g.cols;
+      resize( g, gray, Size(), scale, scale, INTER_AREA );
+    } else {
+      gray = g.clone();
+    }
+  }
+
+  void KeyframeSelector::setKeyframe( const Mat &gray )
+  {
+    vector< KeyPoint > kps;
+    FAST( gray, kps, _params.fastThreshold, true );
+    KeyPointsFilter::retainBest( kps, _params.maxFeatures );
+
+    KeyPoint::convert( kps, _kfPoints );
+    _trackedPoints = _kfPoints;
+    _kfCount = _kfPoints.size();
+
+    _overlap = 1.0;
+    _parallax = 0.0;
+
+    _prevGray = gray;
+  }
+
 };
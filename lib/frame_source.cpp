@@ -0,0 +1,101 @@
+
+#include <thread>
+
+#include <opencv2/core/version.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <glog/logging.h>
+
+#include "AplCam/frame_source.h"
+
+// IMREAD_REDUCED_* were added in OpenCV 3.2
+#if CV_MAJOR_VERSION > 3 || (CV_MAJOR_VERSION == 3 && CV_MINOR_VERSION >= 2)
+#define HAVE_IMREAD_REDUCED
+#endif
+
+namespace AplCam {
+
+  using namespace cv;
+
+  PrefetchingListOfImages::PrefetchingListOfImages( const vector< string > &imgFiles, const Options &opts )
+    : ListOfImages( imgFiles ), _opts( opts ), _next( 0 ), _cancelled( false ), _pool(), _pending()
+  {
+    int threads = _opts.numThreads;
+    if( threads <= 0 ) threads = std::max( 1u, std::thread::hardware_concurrency() );
+    if( _opts.prefetch <= 0 ) _opts.prefetch = threads;
+
+    CHECK( _opts.reduce == 1 || _opts.reduce == 2 || _opts.reduce == 4 || _opts.reduce == 8 )
+      << "Image reduction must be 1, 2, 4 or 8, not " << _opts.reduce;
+
+    // No more than _opts.prefetch jobs are ever outstanding, so
+    // submit() never blocks
+    _pool.reset( new WorkerPool( threads, _opts.prefetch ) );
+
+    fill();
+  }
+
+  PrefetchingListOfImages::~PrefetchingListOfImages()
+  {
+    _cancelled = true;
+    _pool->join();
+  }
+
+  bool PrefetchingListOfImages::read( Mat &img )
+  {
+    if( _pending.empty() ) return false;
+
+    img = _pending.front().get();
+    _pending.pop_front();
+    ++_idx;
+
+    if( img.empty() ) LOG(WARNING) << "Unable to read image " << filename();
+
+    fill();
+    return true;
+  }
+
+  bool PrefetchingListOfImages::read( Mat &img, string &fname )
+  {
+    if( !read( img ) ) return false;
+
+    fname = filename();
+    return true;
+  }
+
+  void PrefetchingListOfImages::fill( void )
+  {
+    while( _next < _imgFiles.size() && _pending.size() < (size_t)_opts.prefetch ) {
+      std::shared_ptr< std::packaged_task< Mat(void) > > task(
+          new std::packaged_task< Mat(void) >( std::bind( &PrefetchingListOfImages::Load,
+              _imgFiles[ _next++ ], _opts.grayscale, _opts.reduce ) ) );
+
+      _pending.push_back( task->get_future() );
+
+      std::atomic< bool > &cancelled( _cancelled );
+      _pool->submit( [task, &cancelled]() { if( !cancelled ) (*task)(); } );
+    }
+  }
+
+  Mat PrefetchingListOfImages::Load( const string &filename, bool grayscale, int reduce )
+  {
+#ifdef HAVE_IMREAD_REDUCED
+    int flags = grayscale ? IMREAD_GRAYSCALE : IMREAD_COLOR;
+    switch( reduce ) {
+      case 2: flags = grayscale ? IMREAD_REDUCED_GRAYSCALE_2 : IMREAD_REDUCED_COLOR_2; break;
+      case 4: flags = grayscale ? IMREAD_REDUCED_GRAYSCALE_4 : IMREAD_REDUCED_COLOR_4; break;
+      case 8: flags = grayscale ? IMREAD_REDUCED_GRAYSCALE_8 : IMREAD_REDUCED_COLOR_8; break;
+    }
+
+    return imread( filename, flags );
+#else
+    Mat img = imread( filename, grayscale ? CV_LOAD_IMAGE_GRAYSCALE : CV_LOAD_IMAGE_COLOR );
+    if( reduce == 1 || img.empty() ) return img;
+
+    Mat out;
+    resize( img, out, Size( (img.cols + reduce - 1) / reduce, (img.rows + reduce - 1) / reduce ),
+            0, 0, INTER_AREA );
+    return out;
+#endif
+  }
+
+}
@@ -14,14 +14,6 @@ namespace AplCam {
   using namespace std;
 
 
-  const string DetectionDb::MetaKey = "meta",
-                DetectionDb::MetaFpsKey = "fps",
-                DetectionDb::MetaWidthKey = "width",
-                DetectionDb::MetaHeightKey = "height",
-                DetectionDb::MetaLengthKey = "length";
-
-
-
   LevelDbDetectionDb::LevelDbDetectionDb( const string dbFile, bool writer )
     : DetectionDb(),
       _db(nullptr)
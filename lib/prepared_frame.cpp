@@ -0,0 +1,123 @@
+
+#include <climits>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "AplCam/prepared_frame.h"
+
+namespace AplCam {
+
+  using namespace cv;
+
+  PreparedFrame::PreparedFrame( const Mat &img )
+    : _image( img ), _gray(), _grayFloat(), _integral(), _undistortedGray(),
+      _undistorter(),
+      _pyramid(), _blurred(), _equalized(),
+      _hits( 0 ), _misses( 0 )
+  {;}
+
+  const Mat &PreparedFrame::gray( void )
+  {
+    if( hit( !_gray.empty() ) ) return _gray;
+
+    switch( _image.channels() ) {
+      case 1:  _gray = _image;  break;
+      case 4:  cvtColor( _image, _gray, CV_BGRA2GRAY );  break;
+      default: cvtColor( _image, _gray, CV_BGR2GRAY );   break;
+    }
+
+    return _gray;
+  }
+
+  const Mat &PreparedFrame::grayFloat( void )
+  {
+    if( hit( !_grayFloat.empty() ) ) return _grayFloat;
+
+    gray().convertTo( _grayFloat, CV_32FC1, 1.0/255.0 );
+    return _grayFloat;
+  }
+
+  const Mat &PreparedFrame::undistortedGray( void )
+  {
+    if( _undistorter.empty() ) return _undistortedGray;
+    if( hit( !_undistortedGray.empty() ) ) return _undistortedGray;
+
+    // Reads the BGR image directly;  doesn't need gray()
+    _undistorter->apply( _image, _undistortedGray );
+    return _undistortedGray;
+  }
+
+  const Mat &PreparedFrame::pyramid( int level )
+  {
+    CV_Assert( level >= 0 );
+    if( level == 0 ) return gray();
+
+    if( hit( (int)_pyramid.size() > level ) ) return _pyramid[level];
+
+    // Levels below this one may also be new;  they're counted as part
+    // of this miss
+    if( _pyramid.empty() ) _pyramid.push_back( gray() );
+    while( (int)_pyramid.size() <= level ) {
+      Mat next;
+      pyrDown( _pyramid.back(), next );
+      _pyramid.push_back( next );
+    }
+
+    return _pyramid[level];
+  }
+
+  const Mat &PreparedFrame::integral( void )
+  {
+    if( hit( !_integral.empty() ) ) return _integral;
+
+    const Mat &g( gray() );
+    const bool mayOverflow = (double)g.total() * 255 > INT_MAX;
+    cv::integral( g, _integral, mayOverflow ? CV_64F : CV_32S );
+
+    return _integral;
+  }
+
+  const Mat &PreparedFrame::blurred( const Size &ksize, double sigma )
+  {
+    for( size_t i = 0; i < _blurred.size(); ++i )
+      if( _blurred[i].ksize == ksize && _blurred[i].sigma == sigma ) {
+        hit( true );
+        return _blurred[i].img;
+      }
+    hit( false );
+
+    Blurred b;
+    b.ksize = ksize;
+    b.sigma = sigma;
+    GaussianBlur( gray(), b.img, ksize, sigma, sigma );
+
+    _blurred.push_back( b );
+    return _blurred.back().img;
+  }
+
+  const Mat &PreparedFrame::equalized( double clipLimit, const Size &tiles )
+  {
+    for( size_t i = 0; i < _equalized.size(); ++i )
+      if( _equalized[i].clipLimit == clipLimit && _equalized[i].tiles == tiles ) {
+        hit( true );
+        return _equalized[i].img;
+      }
+    hit( false );
+
+    // Building a CLAHE allocates its tile histograms;  keep one per
+    // thread and only reconfigure it
+    static thread_local Ptr<CLAHE> clahe;
+    if( clahe.empty() ) clahe = createCLAHE( clipLimit, tiles );
+    clahe->setClipLimit( clipLimit );
+    clahe->setTilesGridSize( tiles );
+
+    Equalized e;
+    e.clipLimit = clipLimit;
+    e.tiles = tiles;
+    clahe->apply( gray(), e.img );
+
+    _equalized.push_back( e );
+    return _equalized.back().img;
+  }
+
+}
@@ -6,6 +6,7 @@
 #include <iostream>
 #include <iomanip>
 #include <algorithm>
+#include <memory>
 
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
@@ -19,6 +20,8 @@
 
 #include "AplCam/splitter_common.h"
 
+#include "AplCam/distortion/camera_factory.h"
+
 using namespace std;
 using namespace cv;
 
@@ -54,6 +57,12 @@ namespace AplCam {
     TCLAP::ValueArg< float > seekToArg("s", "seek-to", "For video sources, seek <sec> frames into the video before starting", false, -1, "sec", cmd );
     TCLAP::ValueArg< float > scaleDisplayArg("S", "scale-display", "If displaying, scale to <mp> megapixels", false, -1, "megapix", cmd );
     TCLAP::ValueArg< float > fpsArg( "f", "fps", "If creating video, specify the frames per second", false, 1, "fps", cmd );
+    TCLAP::ValueArg< int > writeThreadsArg( "", "write-threads", "Number of threads encoding saved frames (default: all cores)", false, 0, "threads", cmd );
+    TCLAP::ValueArg< int > writeQueueArg( "", "write-queue", "Frames which may wait to be written before reading blocks", false, 16, "frames", cmd );
+
+    TCLAP::ValueArg< string > undistortArg( "U", "undistort", "Undistort (and scale, with -S) the display and detection images using this calibration", false, "", "calibration file", cmd );
+
+    TCLAP::ValueArg< string > boardArg( "b", "board", "Detect this board in each split frame", false, "", "board file", cmd );
 
     TCLAP::ValueArg< string > selectorArg( "r", "selector", "Splitting algorithm to use", false, "", "...", cmd );
 
@@ -74,6 +83,12 @@ namespace AplCam {
 
     fps = fpsArg.getValue();
     fpsSet = fpsArg.isSet();
+
+    writeThreads = writeThreadsArg.getValue();
+    writeQueue = writeQueueArg.getValue();
+
+    undistortCamera = undistortArg.getValue();
+    boardFile = boardArg.getValue();
   }
 
 
@@ -84,6 +99,21 @@ namespace AplCam {
       return false;
     }
 
+    if( writeQueue < 1 ) {
+      msg << "Write queue must hold at least one frame.";
+      return false;
+    }
+
+    if( !undistortCamera.empty() && !file_exists( undistortCamera ) ) {
+      msg << "Calibration file \"" << undistortCamera << "\" doesn't exist.";
+      return false;
+    }
+
+    if( !boardFile.empty() && !file_exists( boardFile ) ) {
+      msg << "Board file \"" << boardFile << "\" doesn't exist.";
+      return false;
+    }
+
     return true;
   }
 
@@ -102,12 +132,14 @@ namespace AplCam {
 
 
   SplitterApp::SplitterApp( SplitterOpts options )
-    : _selector( options.makeSelector() ), _videoWriter(), _splitterOpts( options )
+    : _board(), _tracker(), _boardFrames( 0 ),
+      _selector( options.makeSelector() ), _writer(), _splitterOpts( options )
   {;}
 
 
   SplitterApp::SplitterApp( SplitterOpts options, Ptr<FrameSelector> selector )
-    : _selector( selector ), _videoWriter(), _splitterOpts( options )
+    : _board(), _tracker(), _boardFrames( 0 ),
+      _selector( selector ), _writer(), _splitterOpts( options )
   {;}
 
 
@@ -118,32 +150,84 @@ namespace AplCam {
 
 
 
+  bool SplitterApp::processSplitFrame( PreparedFrame &frame, Mat &toDisplay )
+  {
+    Mat img( frame.image() );
+    if( !processSplitFrame( img, toDisplay ) ) return false;
+
+    if( _tracker ) {
+      // Shares the gray and pyramid the selector has already made
+      std::unique_ptr< Detection > det( _tracker->detect( frame ) );
+
+      if( det && det->good() ) {
+        ++_boardFrames;
+
+        // Don't draw on the frame being saved
+        if( toDisplay.data == img.data ) toDisplay = img.clone();
+        _board->draw( toDisplay, det.get() );
+      }
+    }
+
+    return true;
+  }
+
+  bool SplitterApp::makeUndistorter( const Size &imgSize )
+  {
+    Distortion::DistortionModel *cam = Distortion::CameraFactory::LoadDistortionModel( _splitterOpts.undistortCamera );
+    if( cam == NULL ) {
+      LOG(ERROR) << "Couldn't load a camera from \"" << _splitterOpts.undistortCamera << "\"";
+      return false;
+    }
+
+    // Output at scaleDisplay megapixels, never upsampled
+    double scale = 1.0;
+    if( _splitterOpts.scaleDisplay > 0 )
+      scale = std::min( 1.0, sqrt( _splitterOpts.scaleDisplay * 1e6 / imgSize.area() ) );
+
+    // The map is built in the constructor;  cam isn't needed after that
+    _undistorter = new Distortion::UndistortDownscaler( *cam, imgSize, scale );
+    delete cam;
+
+    LOG(INFO) << "Undistorting " << imgSize.width << "x" << imgSize.height << " frames to "
+              << _undistorter->dstSize().width << "x" << _undistorter->dstSize().height;
+    return true;
+  }
+
   bool SplitterApp::run( void ) {
     if( _splitterOpts.doDisplay ) namedWindow( winname );
     int _waitKey = _splitterOpts.waitKey;
 
     double fps = _splitterOpts.fps;
 
-    FrameSource *source = NULL;
+    if( !_splitterOpts.boardFile.empty() && !_board ) {
+      _board.reset( Board::load( _splitterOpts.boardFile, "board" ) );
+      if( !_board ) {
+        LOG(ERROR) << "Couldn't load a board from \"" << _splitterOpts.boardFile << "\"";
+        return false;
+      }
+
+      _tracker.reset( new BoardTracker( *_board ) );
+    }
+
+    std::unique_ptr< FrameSource > source;
     if( _splitterOpts.imgNames.size() == 1 ) {
       // Assume it's a video
       LOG(INFO) << "Attepting to open video " << _splitterOpts.imgNames[0];
       VideoSource *vid = new VideoSource( _splitterOpts.imgNames[0] );
+      source.reset( vid );
 
       if( _splitterOpts.seekTo > 0 ) vid->seekToSeconds( _splitterOpts.seekTo );
       if( _waitKey < 0 ) _waitKey = round(1000 * 1/vid->fps() );
 
       // Hack.  Why is generate video playing too fast?
       if( !_splitterOpts.fpsSet ) fps = vid->fps() / 2;
-
-      source = vid;
     } else {
       LOG(INFO) << "Loading list of " << _splitterOpts.imgNames.size() << " images";
-      source = new ListOfImages( _splitterOpts.imgNames );
+      source.reset( new PrefetchingListOfImages( _splitterOpts.imgNames ) );
       if( _waitKey < 0 ) _waitKey = 1;
     }
 
-    if( source == NULL && source->isOpened() ) {
+    if( !source || !source->isOpened() ) {
       LOG(ERROR) << "Couldn't create a frame source";
       return false;
     }
@@ -152,39 +236,83 @@ namespace AplCam {
     if( _selector.empty() ) LOG(WARNING) << "No frame selector specified.";
 
 
+    if( _splitterOpts.doSaveFrames() || _splitterOpts.doSaveVideo() )
+      _writer = new AsyncFrameWriter( _splitterOpts.writeThreads, _splitterOpts.writeQueue );
+
     Mat img, toDisplay;
-    bool done = false;
+    bool done = false, ok = true;
     _frame = 0;
     int wk = _waitKey;
+
+    int64 readTicks = 0, processTicks = 0, writeTicks = 0;
+    unsigned long cacheHits = 0, cacheMisses = 0;
+    int64 runStart = getTickCount(), readStart = runStart;
     while( source->read( img )  && !done) {
+      unsigned long startTicks = getTickCount();
+      readTicks += startTicks - readStart;
 
       // Only once the first frame has been read
-    if( _frame == 0 && _splitterOpts.doSaveVideo() ) {
-      _videoWriter.open( _splitterOpts.saveVideoTo, CV_FOURCC('X','2','6','4'), fps, img.size() );
-    }
+      if( _frame == 0 && _splitterOpts.doSaveVideo() ) {
+        _writer->openVideo( _splitterOpts.saveVideoTo, CV_FOURCC('X','2','6','4'), fps, img.size() );
+      }
 
-      unsigned long startTicks = getTickCount();
+      if( _frame == 0 && _undistorter.empty() && !_splitterOpts.undistortCamera.empty() ) {
+        if( !makeUndistorter( img.size() ) ) {
+          ok = false;
+          break;
+        }
+      }
 
       toDisplay.release();
 
+      PreparedFrame prepared( img );
+      if( _undistorter && img.depth() == CV_8U && img.size() == _undistorter->srcSize() )
+        prepared.setUndistorter( _undistorter );
+
       bool selected = false;
       if( _selector ) {
-        selected = _selector->process( img );
+        selected = _selector->select( prepared );
         if( selected  ) {
           toDisplay = img;
-          processSplitFrame( img, toDisplay );
+          processSplitFrame( prepared, toDisplay );
         } else {
-          processRejectedFrame( img, toDisplay );
+          processRejectedFrame( prepared, toDisplay );
         }
       } else {
         selected = true;
         toDisplay = img;
-        processSplitFrame( img, toDisplay );
+        processSplitFrame( prepared, toDisplay );
+      }
+
+      cacheHits += prepared.hits();
+      cacheMisses += prepared.misses();
+
+      int64 writeStart = getTickCount();
+      processTicks += writeStart - startTicks;
+
+      if( selected && _splitterOpts.doSaveFrames() ) {
+        char name[256];
+        snprintf( name, 255, "%s/frame_%06d.jpg", _splitterOpts.saveFramesTo.c_str(),_frame );
+        _writer->writeImage( name, img );
+      }
+
+      if( _splitterOpts.doSaveVideo() ) {
+        _writer->writeVideo( toDisplay );
       }
 
+      writeTicks += getTickCount() - writeStart;
+
       if( _splitterOpts.doDisplay && !toDisplay.empty() ) {
 
-        if( _splitterOpts.scaleDisplay > 0 ) {
+        if( prepared.undistorter() && toDisplay.data == img.data ) {
+          // Unannotated;  reuse the frame's copy if a detector made one
+          imshow( winname, prepared.undistortedGray() );
+        } else if( _undistorter && toDisplay.depth() == CV_8U &&
+            toDisplay.size() == _undistorter->srcSize() ) {
+          Mat out;
+          _undistorter->apply( toDisplay, out );
+          imshow( winname, out );
+        } else if( _splitterOpts.scaleDisplay > 0 ) {
           // Shouldn't do this calculation every time
           float factor = _splitterOpts.scaleDisplay  * 1000000 / toDisplay.size().area();
 
@@ -206,22 +334,35 @@ namespace AplCam {
         }
       }
 
-      if( selected && _splitterOpts.doSaveFrames() ) {
-        char name[256];
-        snprintf( name, 255, "%s/frame_%06d.jpg", _splitterOpts.saveFramesTo.c_str(),_frame );
-        cout << "Writing to " << name << endl;
-        imwrite( name, img );
-      }
-
-      if( _splitterOpts.doSaveVideo() > 0 ) {
-        _videoWriter << toDisplay;
-      }
-
       _frame++;
+      readStart = getTickCount();
     }
 
+    // Time spent draining the output queues once input is exhausted
+    int64 drainStart = getTickCount();
+    if( _writer ) _writer->finish();
+    double drainSec = (getTickCount() - drainStart) / getTickFrequency();
+    double totalSec = (getTickCount() - runStart) / getTickFrequency();
+
+    double tf = getTickFrequency();
+    LOG(INFO) << "Processed " << _frame << " frames in " << totalSec << " s ("
+              << _frame / std::max( 1e-6, totalSec ) << " frames/s)";
+    if( _frame > 0 )
+      LOG(INFO) << "Per frame: read " << 1000 * readTicks / tf / _frame
+                << " ms, process " << 1000 * processTicks / tf / _frame
+                << " ms, queue for writing " << 1000 * writeTicks / tf / _frame
+                << " ms;  " << drainSec << " s draining writer at end";
+    if( _frame > 0 && (cacheHits + cacheMisses) > 0 )
+      LOG(INFO) << "Per frame: " << float( cacheHits ) / _frame << " derived images reused, "
+                << float( cacheMisses ) / _frame << " computed";
+    if( _tracker ) {
+      const BoardTracker::Stats &stats( _tracker->stats() );
+      LOG(INFO) << "Board found in " << _boardFrames << " of " << stats.frames << " split frames;  "
+                << stats.cropHits << " from the tracked crop";
+    }
+    if( _writer ) _writer->logStats();
 
-    return true;
+    return ok;
   }
 
 
@@ -0,0 +1,321 @@
+
+#include <cmath>
+#include <cstdio>
+
+#include <opencv2/calib3d/calib3d.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+#include "libg3logger/g3logger.h"
+
+#include "AplCam/synthetic_corpus.h"
+#include "AplCam/detection/flat_detections.h"
+#include "AplCam/detection_archive.h"
+#include "AplCam/file_utils.h"
+
+namespace AplCam {
+
+  using namespace cv;
+  using namespace std;
+
+  // Gray levels of the printed board
+  static const float PaperLevel = 220, InkLevel = 30;
+
+  // Fraction of the pixel footprint [p-w/2, p+w/2] covered by [a,b]
+  static inline float boxCoverage( float p, float w, float a, float b )
+  {
+    const float lo = std::max( a, p - 0.5f*w ), hi = std::min( b, p + 0.5f*w );
+    return std::min( 1.0f, std::max( 0.0f, (hi - lo) / w ) );
+  }
+
+  // Square wave (+1 on [0,1), -1 on [1,2), ...) box-filtered over
+  // [p-w/2, p+w/2].  The wave's integral is a triangle wave.
+  static inline float filteredSquareWave( float p, float w )
+  {
+    const float a = (p - 0.5f*w) * 0.5f, b = (p + 0.5f*w) * 0.5f;
+    return 2.0f * ( std::fabs( a - std::floor(a) - 0.5f ) - std::fabs( b - std::floor(b) - 0.5f ) ) / w;
+  }
+
+  // Minimum footprint, in squares, so the filters never divide by zero
+  static const float MinFootprint = 1e-4;
+
+  SyntheticCorpus::SyntheticCorpus( const Board &board, const Params &params )
+    : _board( board ), _params( params ), _K(), _rays(), _frames()
+  {
+    if( _board.pattern != CHESSBOARD )
+      LOG(WARNING) << "Synthetic corpus renders chessboards only;  board \"" << _board.name << "\" will be drawn as one";
+
+    const double f = (_params.focalLength > 0) ? _params.focalLength : _params.imageSize.width;
+    _K = Matx33d( f, 0, 0.5 * (_params.imageSize.width - 1),
+                  0, f, 0.5 * (_params.imageSize.height - 1),
+                  0, 0, 1 );
+
+    // One batch undistortion of every pixel center, shared by all images
+    Mat pixels( _params.imageSize.area(), 1, CV_32FC2 );
+    for( int y = 0, i = 0; y < _params.imageSize.height; ++y )
+      for( int x = 0; x < _params.imageSize.width; ++x, ++i )
+        pixels.at<Vec2f>(i) = Vec2f( x, y );
+
+    Mat rays;
+    undistortPoints( pixels, rays, Mat( _K ), distCoeffs() );
+    _rays = rays.reshape( 2, _params.imageSize.height );
+  }
+
+  //-------------------------------------------------------------------
+
+  // Board-plane metric coordinates of a point given in squares
+  static inline Point3f squaresToBoard( const Board &board, float s, float t )
+  {
+    return Point3f( (s - 0.5f * (board.width + 1)) * board.squareSize,
+                    (t - 0.5f * (board.height + 1)) * board.squareSize, 0 );
+  }
+
+  bool SyntheticCorpus::boardVisible( const Vec3d &rvec, const Vec3d &tvec ) const
+  {
+    const float lo = -BorderSquares;
+    const float sHi = _board.width + 1 + BorderSquares, tHi = _board.height + 1 + BorderSquares;
+
+    vector< Point3f > outline;
+    outline.push_back( squaresToBoard( _board, lo, lo ) );
+    outline.push_back( squaresToBoard( _board, sHi, lo ) );
+    outline.push_back( squaresToBoard( _board, sHi, tHi ) );
+    outline.push_back( squaresToBoard( _board, lo, tHi ) );
+
+    // All of the board must be in front of the camera ...
+    Matx33d R;
+    Rodrigues( rvec, R );
+    for( size_t i = 0; i < outline.size(); ++i )
+      if( (R * Vec3d( outline[i].x, outline[i].y, 0 ) + tvec)[2] <= 0 ) return false;
+
+    // ... and within the image
+    vector< Point2f > projected;
+    projectPoints( outline, rvec, tvec, Mat( _K ), distCoeffs(), projected );
+
+    const Rect_<float> image( 0, 0, _params.imageSize.width, _params.imageSize.height );
+    for( size_t i = 0; i < projected.size(); ++i )
+      if( !image.contains( projected[i] ) ) return false;
+
+    return true;
+  }
+
+  void SyntheticCorpus::samplePose( std::mt19937 &rng, Vec3d &rvec, Vec3d &tvec ) const
+  {
+    std::uniform_real_distribution< double > uniform( 0.0, 1.0 );
+
+    const double boardWidth = (_board.width + 1 + 2*BorderSquares) * _board.squareSize;
+    const Size &sz( _params.imageSize );
+
+    // Poses which put part of the board outside the image are redrawn;
+    // if none fit, the last is used and its hidden corners dropped.
+    for( int tries = 0; tries < 100; ++tries ) {
+      const double fill = _params.minFill + (_params.maxFill - _params.minFill) * uniform( rng );
+      const double depth = _K(0,0) * boardWidth / (fill * sz.width);
+
+      // Tilt about a random axis in the board plane, then a modest roll
+      // so the board's corner order is unambiguous
+      const double axis = 2 * M_PI * uniform( rng );
+      const double tilt = _params.maxTilt * M_PI / 180.0 * uniform( rng );
+      const double roll = (uniform( rng ) - 0.5) * M_PI / 3;
+
+      Matx33d Rtilt, Rroll;
+      Rodrigues( Vec3d( cos(axis), sin(axis), 0 ) * tilt, Rtilt );
+      Rodrigues( Vec3d( 0, 0, roll ), Rroll );
+      Rodrigues( Rtilt * Rroll, rvec );
+
+      // Center the board on a pixel in the middle half of the image
+      const double u = sz.width * (0.25 + 0.5 * uniform( rng )),
+                   v = sz.height * (0.25 + 0.5 * uniform( rng ));
+      tvec = Vec3d( (u - _K(0,2)) / _K(0,0), (v - _K(1,2)) / _K(1,1), 1.0 ) * depth;
+
+      if( boardVisible( rvec, tvec ) ) return;
+    }
+  }
+
+  void SyntheticCorpus::drawBoard( const Vec3d &rvec, const Vec3d &tvec,
+                                   unsigned char background, Mat &img ) const
+  {
+    const Size &sz( _params.imageSize );
+    img.create( sz, CV_8UC1 );
+
+    // Board (in squares) to normalized image plane:  [r1 r2 t] * A
+    Matx33d R;
+    Rodrigues( rvec, R );
+
+    const double sq = _board.squareSize;
+    const Matx33d A( sq, 0, -0.5 * sq * (_board.width + 1),
+                     0, sq, -0.5 * sq * (_board.height + 1),
+                     0, 0, 1 );
+    const Matx33d H( Matx33d( R(0,0), R(0,1), tvec[0],
+                              R(1,0), R(1,1), tvec[1],
+                              R(2,0), R(2,1), tvec[2] ) * A );
+    const Matx33d Hi( H.inv() );
+
+    const float checkerS = _board.width + 1, checkerT = _board.height + 1;
+    const float paperLo = -BorderSquares,
+                paperS = checkerS + BorderSquares, paperT = checkerT + BorderSquares;
+
+    for( int y = 0; y < sz.height; ++y ) {
+      const Vec2f *ray = _rays.ptr< Vec2f >( y );
+      const Vec2f *nextRow = _rays.ptr< Vec2f >( y < sz.height-1 ? y+1 : y-1 );
+      unsigned char *out = img.ptr< unsigned char >( y );
+
+      for( int x = 0; x < sz.width; ++x ) {
+        const double mx = ray[x][0], my = ray[x][1];
+        const double q2 = Hi(2,0) * mx + Hi(2,1) * my + Hi(2,2);
+
+        // Ray doesn't meet the front of the board
+        if( q2 <= 0 ) { out[x] = background; continue; }
+
+        const double s = (Hi(0,0) * mx + Hi(0,1) * my + Hi(0,2)) / q2,
+                     t = (Hi(1,0) * mx + Hi(1,1) * my + Hi(1,2)) / q2;
+
+        // Pixel footprint on the board: Jacobian of the homography
+        // applied to the step to the neighbouring pixels' rays
+        const Vec2f dx( x < sz.width-1 ? ray[x+1] - ray[x] : ray[x] - ray[x-1] ),
+                    dy( nextRow[x] - ray[x] );
+
+        const double dsdx = (Hi(0,0) - s * Hi(2,0)) / q2, dsdy = (Hi(0,1) - s * Hi(2,1)) / q2,
+                     dtdx = (Hi(1,0) - t * Hi(2,0)) / q2, dtdy = (Hi(1,1) - t * Hi(2,1)) / q2;
+
+        const float ws = std::max( MinFootprint, (float)( fabs( dsdx * dx[0] + dsdy * dx[1] ) + fabs( dsdx * dy[0] + dsdy * dy[1] ) ) ),
+                    wt = std::max( MinFootprint, (float)( fabs( dtdx * dx[0] + dtdy * dx[1] ) + fabs( dtdx * dy[0] + dtdy * dy[1] ) ) );
+
+        const float paper = boxCoverage( s, ws, paperLo, paperS ) * boxCoverage( t, wt, paperLo, paperT );
+        if( paper <= 0 ) { out[x] = background; continue; }
+
+        // Square (0,0) is black
+        const float checker = boxCoverage( s, ws, 0, checkerS ) * boxCoverage( t, wt, 0, checkerT );
+        const float ink = checker * 0.5f * (1.0f + filteredSquareWave( s, ws ) * filteredSquareWave( t, wt ));
+
+        out[x] = saturate_cast< unsigned char >( background * (1.0f - paper) + PaperLevel * (paper - ink) + InkLevel * ink );
+      }
+    }
+  }
+
+  SyntheticCorpus::Frame SyntheticCorpus::render( int i, Mat &img ) const
+  {
+    const uint64_t seed = _params.seed;
+    std::seed_seq seq{ (uint32_t)seed, (uint32_t)(seed >> 32), (uint32_t)i };
+    std::mt19937 rng( seq );
+
+    Frame frame;
+    samplePose( rng, frame.rvec, frame.tvec );
+
+    std::uniform_int_distribution< int > backgroundDist( 40, 200 );
+    drawBoard( frame.rvec, frame.tvec, backgroundDist( rng ), img );
+
+    if( _params.noiseSigma > 0 ) {
+      std::normal_distribution< float > noise( 0, _params.noiseSigma );
+      for( int y = 0; y < img.rows; ++y ) {
+        unsigned char *p = img.ptr< unsigned char >( y );
+        for( int x = 0; x < img.cols; ++x )
+          p[x] = saturate_cast< unsigned char >( p[x] + noise( rng ) );
+      }
+    }
+
+    // Ground truth corners
+    ObjectPointsVec corners;
+    vector< Point3f > world;
+    for( int y = 0; y < _board.height; ++y )
+      for( int x = 0; x < _board.width; ++x ) {
+        corners.push_back( _board.worldLocation( Point2i( x, y ) ) );
+        world.push_back( Point3f( corners.back()[0], corners.back()[1], corners.back()[2] ) );
+      }
+
+    vector< Point2f > projected;
+    projectPoints( world, frame.rvec, frame.tvec, Mat( _K ), distCoeffs(), projected );
+
+    const Rect_<float> image( 0, 0, _params.imageSize.width, _params.imageSize.height );
+    for( size_t c = 0; c < projected.size(); ++c )
+      if( image.contains( projected[c] ) )
+        frame.detection.add( corners[c], ImagePoint( projected[c].x, projected[c].y ), c );
+
+    return frame;
+  }
+
+  //-------------------------------------------------------------------
+
+  struct RenderCorpusBody : public ParallelLoopBody {
+    RenderCorpusBody( const SyntheticCorpus &corpus, vector< SyntheticCorpus::Frame > &frames,
+                      const string &imageDir )
+      : _corpus( corpus ), _frames( frames ), _imageDir( imageDir )
+    {;}
+
+    const SyntheticCorpus &_corpus;
+    vector< SyntheticCorpus::Frame > &_frames;
+    const string &_imageDir;
+
+    virtual void operator()( const Range &r ) const
+    {
+      Mat img;
+      for( int i = r.start; i < r.end; ++i ) {
+        _frames[i] = _corpus.render( i, img );
+
+        if( !_imageDir.empty() ) {
+          char filename[16];
+          snprintf( filename, sizeof(filename), "%06d.png", i );
+          imwrite( _imageDir + "/" + filename, img );
+        }
+      }
+    }
+  };
+
+  bool SyntheticCorpus::generate( int count, const string &archiveFile,
+                                  const string &groundTruthFile, const string &imageDir )
+  {
+    if( count <= 0 ) return false;
+
+    if( !imageDir.empty() ) mkdir_p( imageDir + "/" );
+
+    const int64 start = getTickCount();
+
+    _frames.assign( count, Frame() );
+    parallel_for_( Range( 0, count ), RenderCorpusBody( *this, _frames, imageDir ) );
+
+    LOG(INFO) << "Rendered " << count << " synthetic images in "
+              << (getTickCount() - start) / getTickFrequency() << " s";
+
+    FlatDetections flat;
+    flat.reserve( count, count * _board.width * _board.height );
+    for( int i = 0; i < count; ++i ) flat.add( _frames[i].detection, i );
+
+    if( !DetectionArchive::Write( archiveFile, flat, count, _params.imageSize, 0 ) ) {
+      LOG(WARNING) << "Unable to write detection archive " << archiveFile;
+      return false;
+    }
+
+    if( !groundTruthFile.empty() && !writeGroundTruth( groundTruthFile ) ) {
+      LOG(WARNING) << "Unable to write ground truth to " << groundTruthFile;
+      return false;
+    }
+
+    return true;
+  }
+
+  bool SyntheticCorpus::writeGroundTruth( const string &filename ) const
+  {
+    FileStorage fs( filename, FileStorage::WRITE );
+    if( !fs.isOpened() ) return false;
+
+    Mat rvecs( _frames.size(), 3, CV_64F ), tvecs( _frames.size(), 3, CV_64F );
+    for( size_t i = 0; i < _frames.size(); ++i )
+      for( int j = 0; j < 3; ++j ) {
+        rvecs.at<double>( i, j ) = _frames[i].rvec[j];
+        tvecs.at<double>( i, j ) = _frames[i].tvec[j];
+      }
+
+    fs << "image_width" << _params.imageSize.width;
+    fs << "image_height" << _params.imageSize.height;
+    fs << "camera_matrix" << Mat( _K );
+    fs << "distortion_coefficients" << distCoeffs();
+    fs << "board_width" << _board.width;
+    fs << "board_height" << _board.height;
+    fs << "square_size" << _board.squareSize;
+    fs << "seed" << (double)_params.seed;
+    fs << "rvecs" << rvecs;
+    fs << "tvecs" << tvecs;
+
+    return true;
+  }
+
+}
@@ -0,0 +1,71 @@
+
+#include <gtest/gtest.h>
+
+#include <AprilTags/Tag36h11.h>
+
+#include "AplCam/april_tag_board_generator.h"
+
+namespace {
+
+  using cv::AprilTagBoard;
+
+  // The part of the board seen, starting at board position origin
+  cv::Mat crop( const AprilTagBoard &board, const cv::Point2i &origin, const cv::Size &sz )
+  {
+    cv::Mat ids( sz, CV_16S );
+    for( int y = 0; y < sz.height; ++y )
+      for( int x = 0; x < sz.width; ++x )
+        ids.at< int16_t >( y, x ) = board.codeIdAt( x + origin.x, y + origin.y );
+    return ids;
+  }
+
+  TEST( AprilTagBoard, MostLikelyAlignment ) {
+    AprilTagBoard board( AprilTags::tagCodes36h11, cv::Size( 7, 5 ) );
+
+    const cv::Point2i origin( 2, 1 );
+    cv::Mat ids( crop( board, origin, cv::Size( 4, 3 ) ) );
+
+    // One tag missed, one misread as an id from elsewhere on the board
+    ids.at< int16_t >( 0, 0 ) = -1;
+    ids.at< int16_t >( 2, 3 ) = board.codeIdAt( 0, 0 );
+
+    cv::Mat valid;
+    cv::Mat positions( board.mostLikelyAlignment( ids, valid ) );
+    ASSERT_EQ( ids.size(), positions.size() );
+    ASSERT_EQ( CV_32FC3, positions.type() );
+
+    // Positions are the board locations the ids sit on, misread or not
+    for( int y = 0; y < ids.rows; ++y )
+      for( int x = 0; x < ids.cols; ++x ) {
+        EXPECT_EQ( 1, valid.at< uchar >( y, x ) );
+
+        const cv::Point3f expected( board.locationAt( x + origin.x, y + origin.y ) );
+        const cv::Point3f &p( positions.at< cv::Point3f >( y, x ) );
+        EXPECT_FLOAT_EQ( expected.x, p.x ) << x << ',' << y;
+        EXPECT_FLOAT_EQ( expected.y, p.y ) << x << ',' << y;
+      }
+  }
+
+  TEST( AprilTagBoard, PartlyOffBoard ) {
+    AprilTagBoard board( AprilTags::tagCodes36h11, cv::Size( 5, 5 ) );
+
+    // The seen grid extends one column past the right of the board
+    cv::Mat ids( 2, 3, CV_16S, cv::Scalar(-1) );
+    for( int y = 0; y < 2; ++y )
+      for( int x = 0; x < 2; ++x )
+        ids.at< int16_t >( y, x ) = board.codeIdAt( x + 3, y + 2 );
+
+    cv::Mat valid;
+    cv::Mat positions( board.mostLikelyAlignment( ids, valid ) );
+    ASSERT_FALSE( positions.empty() );
+
+    for( int y = 0; y < 2; ++y ) {
+      EXPECT_EQ( 1, valid.at< uchar >( y, 0 ) );
+      EXPECT_EQ( 1, valid.at< uchar >( y, 1 ) );
+      EXPECT_EQ( 0, valid.at< uchar >( y, 2 ) );
+
+      EXPECT_FLOAT_EQ( board.locationAt( 4, y + 2 ).x, positions.at< cv::Point3f >( y, 1 ).x );
+    }
+  }
+
+}
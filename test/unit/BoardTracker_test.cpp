@@ -0,0 +1,61 @@
+
+#include <gtest/gtest.h>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "AplCam/board_tracker.h"
+#include "AplCam/synthetic_corpus.h"
+
+namespace {
+
+  using namespace AplCam;
+
+  TEST( BoardTracker, CropsAroundShiftedBoard ) {
+    Board board( CHESSBOARD, 8, 6, 0.025, "test" );
+
+    // A nearly fronto-parallel board filling under half the frame
+    SyntheticCorpus::Params params;
+    params.imageSize = cv::Size( 640, 480 );
+    params.minFill = 0.4;
+    params.maxFill = 0.45;
+    params.maxTilt = 10;
+    params.noiseSigma = 1;
+    params.seed = 7;
+
+    SyntheticCorpus corpus( board, params );
+    cv::Mat img;
+    corpus.render( 0, img );
+
+    BoardTracker tracker( board );
+
+    // First frame has no prediction, so searches the full frame
+    std::unique_ptr< Detection > first( tracker.detect( img ) );
+    ASSERT_TRUE( first.get() != NULL );
+    ASSERT_EQ( 48u, first->size() );
+    EXPECT_TRUE( tracker.tracking() );
+    EXPECT_EQ( 1u, tracker.stats().fullFrame );
+
+    // Move the board a little
+    const int dx = 12, dy = -8;
+    cv::Mat shifted;
+    cv::warpAffine( img, shifted, cv::Matx23d( 1, 0, dx, 0, 1, dy ), img.size(),
+                    cv::INTER_NEAREST, cv::BORDER_REPLICATE );
+
+    std::unique_ptr< Detection > second( tracker.detect( shifted ) );
+    ASSERT_TRUE( second.get() != NULL );
+    ASSERT_EQ( first->size(), second->size() );
+
+    // Found in the crop, which is smaller than the frame ...
+    EXPECT_EQ( 1u, tracker.stats().cropHits );
+    EXPECT_EQ( 1u, tracker.stats().fullFrame );
+    EXPECT_GT( tracker.lastCrop().area(), 0 );
+    EXPECT_LT( tracker.lastCrop().area(), img.size().area() );
+
+    // ... and reported in full-frame coordinates
+    for( size_t i = 0; i < first->size(); ++i ) {
+      EXPECT_NEAR( first->points[i][0] + dx, second->points[i][0], 0.25 );
+      EXPECT_NEAR( first->points[i][1] + dy, second->points[i][1], 0.25 );
+    }
+  }
+
+}
@@ -0,0 +1,81 @@
+
+#include <algorithm>
+#include <memory>
+
+#include <gtest/gtest.h>
+
+#include "AplCam/board/board.h"
+#include "AplCam/detection/detection.h"
+#include "AplCam/prepared_frame.h"
+#include "AplCam/synthetic_corpus.h"
+
+namespace {
+
+  using namespace AplCam;
+
+  struct TestBoard : public Board {
+    TestBoard( void ) : Board( CHESSBOARD, 8, 6, 0.025, "test" ) {;}
+
+    using Board::chessboardDecimation;
+  };
+
+  // A large, nearly fronto-parallel board in a large image
+  SyntheticCorpus::Params largeParams( void )
+  {
+    SyntheticCorpus::Params params;
+    params.imageSize = cv::Size( 2560, 1920 );
+    params.minFill = 0.5;
+    params.maxFill = 0.6;
+    params.maxTilt = 10;
+    params.noiseSigma = 1;
+    params.seed = 11;
+    return params;
+  }
+
+  // Largest corner error, allowing for findChessboardCorners returning
+  // the corners in reverse order
+  float maxError( const Detection &found, const Detection &truth )
+  {
+    float fwd = 0, rev = 0;
+    const size_t n = truth.size();
+    for( size_t i = 0; i < n; ++i ) {
+      fwd = std::max< float >( fwd, cv::norm( found.points[i] - truth.points[i] ) );
+      rev = std::max< float >( rev, cv::norm( found.points[i] - truth.points[n-1-i] ) );
+    }
+    return std::min( fwd, rev );
+  }
+
+  void checkDetection( TestBoard &board, bool decimated )
+  {
+    SyntheticCorpus corpus( board, largeParams() );
+    cv::Mat img;
+    SyntheticCorpus::Frame truth( corpus.render( 0, img ) );
+    ASSERT_EQ( 48u, truth.detection.size() );
+
+    // Square size from the ground truth, as a previous frame would give
+    board.setExpectedSquarePixels( cv::norm( truth.detection.points[1] - truth.detection.points[0] ) );
+    if( decimated )
+      EXPECT_GE( board.chessboardDecimation( img.size() ), 1 );
+    else
+      EXPECT_EQ( 0, board.chessboardDecimation( img.size() ) );
+
+    PreparedFrame frame( img );
+    std::unique_ptr< Detection > det( board.detect( frame ) );
+    ASSERT_TRUE( det.get() != NULL );
+    ASSERT_EQ( truth.detection.size(), det->size() );
+
+    EXPECT_LT( maxError( *det, truth.detection ), 0.2 );
+  }
+
+  TEST( Board, DecimatedChessboard ) {
+    TestBoard board;
+    checkDetection( board, true );
+  }
+
+  TEST( Board, FullResolutionChessboard ) {
+    TestBoard board;
+    board.setMaxDecimation( 0 );
+    checkDetection( board, false );
+  }
+
+}
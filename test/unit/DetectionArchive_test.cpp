@@ -0,0 +1,94 @@
+
+#include <fstream>
+
+#include <gtest/gtest.h>
+
+#include "AplCam/detection_archive.h"
+
+namespace {
+
+  using namespace AplCam;
+
+  TEST( DetectionArchive, RoundTrip ) {
+    const std::string filename( "/tmp/detection_archive_test.bin" );
+
+    FrameIndexedDetectionDb db;
+    db.setMeta( 100, 1920, 1080, 29.97 );
+
+    for( int frame = 0; frame < 100; frame += 10 ) {
+      Detection det;
+      for( int i = 0; i < frame/10; ++i )
+        det.add( ObjectPoint( i, frame, 0 ), ImagePoint( i, frame ), i );
+      db.insertFrame( frame, det );
+    }
+
+    ASSERT_TRUE( DetectionArchive::Write( filename, db ) );
+
+    DetectionArchive archive( filename );
+    ASSERT_TRUE( archive.isOpen() );
+
+    EXPECT_EQ( 10u, archive.size() );
+    EXPECT_EQ( 45u, archive.totalPoints() );
+    EXPECT_EQ( 100u, archive.length() );
+    EXPECT_EQ( cv::Size( 1920, 1080 ), archive.imageSize() );
+    EXPECT_FLOAT_EQ( 29.97, archive.fps() );
+
+    DetectionView view;
+    ASSERT_TRUE( archive.find( 40, view ) );
+    EXPECT_EQ( 40, view.frame );
+    ASSERT_EQ( 4u, view.size() );
+    EXPECT_EQ( 3, view.ids[3] );
+    EXPECT_FLOAT_EQ( 40, view.points[3][1] );
+    EXPECT_FLOAT_EQ( 40, view.corners[3][1] );
+
+    EXPECT_FALSE( archive.find( 41, view ) );
+  }
+
+  TEST( DetectionArchive, RejectsGarbage ) {
+    const std::string filename( "/tmp/detection_archive_garbage.bin" );
+    {
+      std::ofstream out( filename.c_str() );
+      out << "This is not an archive, but it is long enough to hold a header.  Honest.";
+    }
+
+    DetectionArchive archive( filename );
+    EXPECT_FALSE( archive.isOpen() );
+  }
+
+  TEST( DetectionArchive, RejectsBadOffsets ) {
+    const std::string filename( "/tmp/detection_archive_offsets.bin" );
+
+    FrameIndexedDetectionDb db;
+    db.setMeta( 10, 640, 480, 30 );
+    for( int frame = 0; frame < 4; ++frame ) {
+      Detection det;
+      det.add( ObjectPoint( frame, 0, 0 ), ImagePoint( frame, 0 ), frame );
+      db.insertFrame( frame, det );
+    }
+    ASSERT_TRUE( DetectionArchive::Write( filename, db ) );
+
+    DetectionArchive::Header h;
+    {
+      std::ifstream in( filename.c_str(), std::ios::binary );
+      in.read( reinterpret_cast< char * >( &h ), sizeof(h) );
+    }
+
+    // Point a middle frame past the end of the point arrays
+    {
+      std::fstream io( filename.c_str(), std::ios::binary | std::ios::in | std::ios::out );
+      const uint64_t bad = 1000000;
+      io.seekp( h.offsetsOffset + 2 * sizeof(uint64_t) );
+      io.write( reinterpret_cast< const char * >( &bad ), sizeof(bad) );
+    }
+
+    DetectionArchive archive( filename );
+    EXPECT_FALSE( archive.isOpen() );
+
+    // Metadata of a closed archive is zero rather than a crash
+    EXPECT_EQ( 0u, archive.size() );
+    EXPECT_EQ( 0u, archive.length() );
+    EXPECT_EQ( cv::Size(), archive.imageSize() );
+    EXPECT_FLOAT_EQ( 0, archive.fps() );
+  }
+
+}
@@ -0,0 +1,105 @@
+
+#include <gtest/gtest.h>
+
+#include "AplCam/detection_set.h"
+
+namespace {
+
+  using namespace AplCam;
+
+  Detection *makeDetection( int n, int base )
+  {
+    Detection *det = new Detection;
+    for( int i = 0; i < n; ++i )
+      det->add( ObjectPoint( base+i, 0, 0 ), ImagePoint( base+i, 1 ), base+i );
+    return det;
+  }
+
+  TEST( FlatDetections, AddAndView ) {
+    DetectionSet set;
+
+    set.addDetection( makeDetection( 3, 0 ), 10 );
+    set.addDetection( makeDetection( 5, 100 ), 20 );
+
+    ASSERT_EQ( 2u, set.size() );
+    ASSERT_EQ( 8u, set.flat().totalPoints() );
+
+    DetectionView v( set[1] );
+    EXPECT_EQ( 20, v.frame );
+    ASSERT_EQ( 5u, v.size() );
+    EXPECT_EQ( 100, v.ids[0] );
+    EXPECT_FLOAT_EQ( 104, v.points[4][0] );
+    EXPECT_FLOAT_EQ( 104, v.corners[4][0] );
+  }
+
+  // Rejects frames with fewer than four points, and counts calls
+  struct PickyDetection : public Detection {
+    PickyDetection( int *calls ) : _calls( calls ) {;}
+
+    virtual Validate_Return_Code validate( void )
+    {
+      ++(*_calls);
+      return size() < 4 ? NOT_ENOUGH_POINTS : ALL_VALID;
+    }
+
+    int *_calls;
+  };
+
+  TEST( FlatDetections, LazyValidate ) {
+    DetectionSet set;
+    int calls = 0;
+
+    for( int i = 0; i < 3; ++i ) {
+      PickyDetection *det = new PickyDetection( &calls );
+      for( int j = 0; j < 3*i+1; ++j )
+        det->add( ObjectPoint( j, 0, 0 ), ImagePoint( j, 1 ), j );
+      set.addDetection( det, i );
+    }
+
+    Detection *copied = makeDetection( 1, 0 );
+    set.addDetection( *copied, 3 );
+    delete copied;
+
+    ASSERT_EQ( 4u, set.size() );
+    EXPECT_EQ( 0, calls );
+
+    // Frames have 1, 4 and 7 points, so frame 0 fails;  the copied
+    // frame 3 is never validated and is kept
+    EXPECT_EQ( 3, set.validate() );
+    EXPECT_EQ( 3, calls );
+    EXPECT_EQ( 1, set.frames()[0] );
+    EXPECT_EQ( 2, set.frames()[1] );
+    EXPECT_EQ( 3, set.frames()[2] );
+    EXPECT_EQ( 12u, set.flat().totalPoints() );
+
+    // Already validated
+    EXPECT_EQ( 3, set.validate() );
+    EXPECT_EQ( 3, calls );
+  }
+
+  TEST( FlatDetections, Compact ) {
+    FlatDetections flat;
+
+    for( int i = 0; i < 4; ++i ) {
+      Detection *det = makeDetection( i+1, i*10 );
+      flat.add( *det, i );
+      delete det;
+    }
+
+    vector< bool > keep( 4, true );
+    keep[0] = keep[2] = false;
+    flat.compact( keep );
+
+    ASSERT_EQ( 2u, flat.size() );
+    EXPECT_EQ( 6u, flat.totalPoints() );
+    EXPECT_EQ( 1, flat.frame(0) );
+    EXPECT_EQ( 3, flat.frame(1) );
+    EXPECT_EQ( 2u, flat.count(0) );
+    EXPECT_EQ( 30, flat[1].ids[0] );
+
+    ImagePointsVecVec pts( flat.imagePointsVecVec() );
+    ASSERT_EQ( 2u, pts.size() );
+    EXPECT_EQ( 4u, pts[1].size() );
+  }
+
+}
@@ -0,0 +1,123 @@
+
+#include <gtest/gtest.h>
+
+#include "AplCam/detection_db.h"
+#include "nlohmann/json.hpp"
+
+namespace {
+
+  using namespace AplCam;
+
+  Detection makeDetection( int id )
+  {
+    Detection det;
+    det.add( ObjectPoint( id, 0, 0 ), ImagePoint( id, 0 ), id );
+    return det;
+  }
+
+  TEST( FrameIndexedDetectionDb, InsertAndFind ) {
+    FrameIndexedDetectionDb db;
+
+    ASSERT_TRUE( db.insertFrame( 5, makeDetection( 5 ) ) );
+    ASSERT_TRUE( db.insertFrame( 2, makeDetection( 2 ) ) );
+
+    EXPECT_EQ( 2u, db.count() );
+    EXPECT_TRUE( db.has( 5 ) );
+    EXPECT_FALSE( db.has( 3 ) );
+    EXPECT_FALSE( db.has( 100 ) );
+    EXPECT_TRUE( db.find( 3 ) == NULL );
+    ASSERT_TRUE( db.find( 2 ) != NULL );
+    EXPECT_EQ( 2, db.find( 2 )->ids[0] );
+
+    // Frames are visited in order
+    vector< int > frames;
+    db.forEach( [&]( int frame, const Detection & ) { frames.push_back( frame ); } );
+    ASSERT_EQ( 2u, frames.size() );
+    EXPECT_EQ( 2, frames[0] );
+    EXPECT_EQ( 5, frames[1] );
+  }
+
+  TEST( FrameIndexedDetectionDb, StringKeyAdapter ) {
+    FrameIndexedDetectionDb db;
+    DetectionDb &base( db );
+
+    std::shared_ptr<Detection> det( new Detection( makeDetection( 7 ) ) );
+    EXPECT_TRUE( base.insert( "7", det ) );
+    EXPECT_FALSE( base.insert( "frame_7", det ) );
+
+    ASSERT_TRUE( (bool)base.at( "7" ) );
+    EXPECT_EQ( 7, base.atFrame( 7 )->ids[0] );
+    EXPECT_FALSE( (bool)base.at( "8" ) );
+  }
+
+  TEST( FrameIndexedDetectionDb, VisitFrames ) {
+    FrameIndexedDetectionDb db;
+    DetectionDb &base( db );
+
+    db.insertFrame( 4, makeDetection( 4 ) );
+    db.insertFrame( 1, makeDetection( 1 ) );
+
+    vector< int > frames;
+    EXPECT_TRUE( base.visitFrames( [&]( int frame, const Detection &det ) {
+      EXPECT_EQ( frame, det.ids[0] );
+      frames.push_back( frame );
+    }) );
+
+    ASSERT_EQ( 2u, frames.size() );
+    EXPECT_EQ( 1, frames[0] );
+    EXPECT_EQ( 4, frames[1] );
+  }
+
+  TEST( FrameIndexedDetectionDb, BoundsInserts ) {
+    FrameIndexedDetectionDb db;
+
+    // No length yet:  may only grow so far at once
+    EXPECT_FALSE( db.insertFrame( 1000000000, makeDetection( 0 ) ) );
+    EXPECT_EQ( 0u, db.endFrame() );
+    EXPECT_TRUE( db.insertFrame( FrameIndexedDetectionDb::MaxFrameGap - 1, makeDetection( 0 ) ) );
+
+    FrameIndexedDetectionDb withMeta;
+    withMeta.setMeta( 10, 640, 480, 30 );
+    EXPECT_TRUE( withMeta.insertFrame( 9, makeDetection( 9 ) ) );
+    EXPECT_FALSE( withMeta.insertFrame( 10, makeDetection( 10 ) ) );
+    EXPECT_EQ( 10u, withMeta.endFrame() );
+  }
+
+  TEST( FrameIndexedDetectionDb, JsonRoundTrip ) {
+    FrameIndexedDetectionDb db;
+    db.insertFrame( 1, makeDetection( 1 ) );
+    db.insertFrame( 10, makeDetection( 10 ) );
+
+    json j = db;
+    FrameIndexedDetectionDb db2 = j;
+
+    EXPECT_EQ( 2u, db2.count() );
+    ASSERT_TRUE( db2.has( 10 ) );
+    EXPECT_EQ( 10, db2.find( 10 )->ids[0] );
+  }
+
+  TEST( FrameIndexedDetectionDb, SharedWith ) {
+    FrameIndexedDetectionDb a, b;
+
+    Detection da, db;
+    for( int id = 0; id < 10; ++id ) da.add( ObjectPoint( id, 0, 0 ), ImagePoint( id, 0 ), id );
+    // Unsorted, partly overlapping
+    for( int id = 14; id >= 5; --id ) db.add( ObjectPoint( id, 0, 0 ), ImagePoint( id, 1 ), id );
+
+    a.insertFrame( 3, da );
+    b.insertFrame( 3, db );
+    b.insertFrame( 4, db );
+
+    vector< int > frames;
+    vector< SharedPoints > shared;
+    sharedWith( a, b, frames, shared );
+
+    ASSERT_EQ( 1u, frames.size() );
+    EXPECT_EQ( 3, frames[0] );
+    ASSERT_EQ( 5u, shared[0].worldPoints.size() );
+    EXPECT_FLOAT_EQ( 5, shared[0].imagePoints[0][0][0] );
+    EXPECT_FLOAT_EQ( 5, shared[0].imagePoints[1][0][0] );
+    EXPECT_FLOAT_EQ( 1, shared[0].imagePoints[1][0][1] );
+  }
+
+}
@@ -0,0 +1,95 @@
+
+#include <cmath>
+
+#include <gtest/gtest.h>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "AplCam/hough_circles.h"
+
+namespace {
+
+  using namespace AplCam;
+
+  // Three bright discs on black, lightly blurred
+  cv::Mat makeCircles( std::vector< cv::Vec3f > &truth )
+  {
+    truth.clear();
+    truth.push_back( cv::Vec3f( 160, 120, 30 ) );
+    truth.push_back( cv::Vec3f( 420, 300, 45 ) );
+    truth.push_back( cv::Vec3f( 520, 100, 20 ) );
+
+    cv::Mat img( 480, 640, CV_8UC1, cv::Scalar(0) );
+    for( size_t i = 0; i < truth.size(); ++i )
+      cv::circle( img, cv::Point( truth[i][0], truth[i][1] ), truth[i][2], cv::Scalar(255), -1 );
+
+    cv::GaussianBlur( img, img, cv::Size(5,5), 0 );
+    return img;
+  }
+
+  // Index of the circle in found closest (by center) to c, or -1
+  template< typename T >
+  int closest( const std::vector< T > &found, const cv::Vec3f &c, double maxDist )
+  {
+    int best = -1;
+    for( size_t i = 0; i < found.size(); ++i ) {
+      const double d = std::hypot( found[i][0] - c[0], found[i][1] - c[1] );
+      if( d < maxDist && (best < 0 || d < std::hypot( found[best][0] - c[0], found[best][1] - c[1] )) ) best = i;
+    }
+    return best;
+  }
+
+  TEST( HoughCircles, FindsSyntheticCircles ) {
+    std::vector< cv::Vec3f > truth;
+    cv::Mat img( makeCircles( truth ) );
+
+    Circles_t found;
+    AplCam::HoughCircles( img, found, CV_HOUGH_GRADIENT, 1, 20, 100, 20, 15, 60 );
+
+    ASSERT_GE( found.size(), truth.size() );
+    for( size_t i = 0; i < truth.size(); ++i ) {
+      const int j = closest( found, truth[i], 2.0 );
+      ASSERT_GE( j, 0 ) << "No circle near " << truth[i];
+      EXPECT_NEAR( truth[i][2], found[j][2], 2.0 );
+    }
+  }
+
+  TEST( HoughCircles, AgreesWithOpenCV ) {
+    std::vector< cv::Vec3f > truth;
+    cv::Mat img( makeCircles( truth ) );
+
+    std::vector< cv::Vec3f > reference;
+    cv::HoughCircles( img, reference, CV_HOUGH_GRADIENT, 1, 20, 100, 20, 15, 60 );
+
+    Circles_t found;
+    AplCam::HoughCircles( img, found, CV_HOUGH_GRADIENT, 1, 20, 100, 20, 15, 60 );
+
+    // Every circle OpenCV finds on a real target, we find too
+    for( size_t i = 0; i < reference.size(); ++i ) {
+      if( closest( truth, reference[i], 3.0 ) < 0 ) continue;
+
+      const int j = closest( found, reference[i], 2.0 );
+      ASSERT_GE( j, 0 ) << "No circle near OpenCV's " << reference[i];
+      EXPECT_NEAR( reference[i][2], found[j][2], 2.0 );
+    }
+  }
+
+  TEST( HoughCircles, SearchesOnlyRoi ) {
+    std::vector< cv::Vec3f > truth;
+    cv::Mat img( makeCircles( truth ) );
+
+    // Around the second circle only
+    const cv::Rect roi( 340, 220, 160, 160 );
+
+    Circles_t found;
+    AplCam::HoughCircles( img, found, CV_HOUGH_GRADIENT, 1, 20, 100, 20, 15, 60, roi );
+
+    ASSERT_GE( found.size(), 1u );
+    EXPECT_NEAR( truth[1][0], found[0][0], 2.0 );
+    EXPECT_NEAR( truth[1][1], found[0][1], 2.0 );
+
+    for( size_t i = 0; i < found.size(); ++i )
+      EXPECT_TRUE( roi.contains( cv::Point( found[i][0], found[i][1] ) ) );
+  }
+
+}
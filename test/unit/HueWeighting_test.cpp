@@ -0,0 +1,70 @@
+
+#include <gtest/gtest.h>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "AplCam/board/circle.h"
+
+namespace {
+
+  using namespace AplCam;
+
+  // HSV row of the target hue at increasing s = v
+  cv::Mat makeRamp( float hueDeg )
+  {
+    cv::Mat hsv( 1, 256, CV_8UC3 );
+    for( int i = 0; i < 256; ++i )
+      hsv.at< cv::Vec3b >( 0, i ) = cv::Vec3b( cvRound( hueDeg / 2 ), i, i );
+    return hsv;
+  }
+
+  TEST( HueWeighting, KeepsWeakMatches ) {
+    HueWeighting weighting( 30 );
+    cv::Mat hsv( makeRamp( 30 ) ), weight;
+
+    weighting.apply( hsv, weight );
+    ASSERT_EQ( CV_16UC1, weight.type() );
+
+    // The 8-bit product is round(i*i/255), so from i = 12 it's nonzero,
+    // and so is its 16-bit square.  An 8-bit square lost everything
+    // below i = 55.
+    for( int i = 12; i < 256; ++i )
+      EXPECT_GT( weight.at< ushort >( 0, i ), 0 ) << i;
+
+    // ... and increasing
+    for( int i = 1; i < 256; ++i )
+      EXPECT_GE( weight.at< ushort >( 0, i ), weight.at< ushort >( 0, i-1 ) );
+  }
+
+  TEST( HueWeighting, ApplyAllMatchesApply ) {
+    HueWeighting orange( HueWeighting::HueOf( cv::Scalar( 0, 128, 255 ) ) ), blue( 240 );
+
+    cv::Mat bgr( 64, 64, CV_8UC3 ), hsv;
+    cv::randu( bgr, cv::Scalar::all(0), cv::Scalar::all(256) );
+    cv::cvtColor( bgr, hsv, CV_BGR2HSV );
+
+    std::vector< const HueWeighting * > weightings;
+    weightings.push_back( &orange );
+    weightings.push_back( &blue );
+
+    std::vector< cv::Mat > weights;
+    HueWeighting::ApplyAll( hsv, weightings, weights );
+    ASSERT_EQ( 2u, weights.size() );
+
+    for( size_t t = 0; t < weightings.size(); ++t ) {
+      cv::Mat expected;
+      weightings[t]->apply( hsv, expected );
+      ASSERT_EQ( expected.type(), weights[t].type() );
+
+      // Differ only in the order of rounding the 8-bit products, which
+      // puts each within one step of the exact value before squaring
+      cv::Mat e, w;
+      expected.convertTo( e, CV_32F );
+      weights[t].convertTo( w, CV_32F );
+      cv::sqrt( e, e );
+      cv::sqrt( w, w );
+      EXPECT_LE( cv::norm( e, w, cv::NORM_INF ), 2.01 );
+    }
+  }
+
+}
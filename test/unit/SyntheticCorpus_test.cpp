@@ -0,0 +1,56 @@
+
+#include <gtest/gtest.h>
+
+#include "AplCam/synthetic_corpus.h"
+#include "AplCam/detection_archive.h"
+
+namespace {
+
+  using namespace AplCam;
+
+  SyntheticCorpus::Params smallParams( void )
+  {
+    SyntheticCorpus::Params params;
+    params.imageSize = cv::Size( 320, 240 );
+    params.seed = 42;
+    return params;
+  }
+
+  TEST( SyntheticCorpus, Reproducible ) {
+    Board board( CHESSBOARD, 8, 6, 0.025, "test" );
+    SyntheticCorpus a( board, smallParams() ), b( board, smallParams() );
+
+    // Order of rendering must not matter
+    cv::Mat imgA, imgB;
+    b.render( 2, imgB );
+    SyntheticCorpus::Frame frameA = a.render( 3, imgA );
+    SyntheticCorpus::Frame frameB = b.render( 3, imgB );
+
+    ASSERT_EQ( frameA.detection.size(), frameB.detection.size() );
+    EXPECT_EQ( frameA.rvec, frameB.rvec );
+    EXPECT_EQ( frameA.tvec, frameB.tvec );
+    EXPECT_EQ( 0, cv::norm( imgA, imgB, cv::NORM_INF ) );
+  }
+
+  TEST( SyntheticCorpus, WritesArchive ) {
+    const std::string filename( "/tmp/synthetic_corpus_test.bin" );
+
+    Board board( CHESSBOARD, 8, 6, 0.025, "test" );
+    SyntheticCorpus corpus( board, smallParams() );
+
+    ASSERT_TRUE( corpus.generate( 8, filename ) );
+
+    DetectionArchive archive( filename );
+    ASSERT_TRUE( archive.isOpen() );
+    EXPECT_EQ( 8u, archive.size() );
+    EXPECT_EQ( cv::Size( 320, 240 ), archive.imageSize() );
+
+    DetectionView view;
+    ASSERT_TRUE( archive.find( 5, view ) );
+    ASSERT_EQ( corpus.frames()[5].detection.size(), view.size() );
+    ASSERT_GT( view.size(), 0u );
+    EXPECT_FLOAT_EQ( corpus.frames()[5].detection.points[0][0], view.points[0][0] );
+    EXPECT_EQ( corpus.frames()[5].detection.ids[0], view.ids[0] );
+  }
+
+}
@@ -0,0 +1,96 @@
+
+#include <gtest/gtest.h>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "AplCam/distortion/undistort_downscaler.h"
+#include "AplCam/distortion/radial_polynomial.h"
+#include "AplCam/prepared_frame.h"
+
+namespace {
+
+  using namespace Distortion;
+
+  typedef UndistortDownscaler::Tap Tap;
+
+  static const int One = 1 << UndistortDownscaler::WeightBits;
+
+  int weightSum( const Tap &tap )
+  { return tap.w[0] + tap.w[1] + tap.w[2] + tap.w[3]; }
+
+  TEST( UndistortDownscaler, WeightsSumToOne ) {
+    const cv::Size sz( 640, 480 );
+    const float fracs[] = { 0, 0.0003, 0.001, 0.25, 0.4999, 0.5, 0.5001, 0.75, 0.999, 0.9997 };
+
+    for( size_t i = 0; i < sizeof(fracs)/sizeof(fracs[0]); ++i )
+      for( size_t j = 0; j < sizeof(fracs)/sizeof(fracs[0]); ++j ) {
+        const float fx = fracs[i], fy = fracs[j];
+        Tap tap = UndistortDownscaler::MakeTap( 100 + fx, 200 + fy, sz );
+
+        ASSERT_EQ( 100, tap.x );
+        ASSERT_EQ( 200, tap.y );
+        EXPECT_EQ( One, weightSum( tap ) ) << fx << ',' << fy;
+
+        for( int k = 0; k < 4; ++k ) EXPECT_LE( tap.w[k], One );
+
+        // Reproduces the bilinear weights to within rounding
+        EXPECT_NEAR( (1-fx)*(1-fy)*One, tap.w[0], 1.5 );
+        EXPECT_NEAR( fx*(1-fy)*One,     tap.w[1], 1.5 );
+        EXPECT_NEAR( (1-fx)*fy*One,     tap.w[2], 1.5 );
+        EXPECT_NEAR( fx*fy*One,         tap.w[3], 1.5 );
+      }
+  }
+
+  TEST( UndistortDownscaler, LastColumnAndRow ) {
+    const cv::Size sz( 640, 480 );
+
+    Tap tap = UndistortDownscaler::MakeTap( 639, 479, sz );
+    ASSERT_EQ( 638, tap.x );
+    ASSERT_EQ( 478, tap.y );
+    EXPECT_EQ( One, tap.w[3] );
+    EXPECT_EQ( One, weightSum( tap ) );
+
+    EXPECT_EQ( -1, UndistortDownscaler::MakeTap( 639.01, 100, sz ).x );
+    EXPECT_EQ( -1, UndistortDownscaler::MakeTap( 100, -0.01, sz ).x );
+  }
+
+  // With no distortion, the fused pass is just gray + a 2x downscale
+  TEST( UndistortDownscaler, PreparedFrameUndistortedGray ) {
+    const cv::Size sz( 640, 480 );
+    RadialPolynomial cam( cv::Vec4d( 0, 0, 0, 0 ),
+                          cv::Matx33d( 500, 0, 319.5, 0, 500, 239.5, 0, 0, 1 ) );
+
+    cv::Ptr< UndistortDownscaler > undistorter( new UndistortDownscaler( cam, sz, 0.5 ) );
+    ASSERT_EQ( cv::Size( 320, 240 ), undistorter->dstSize() );
+
+    // Smooth colour ramps, so the 2x2 average and INTER_AREA agree
+    cv::Mat img( sz, CV_8UC3 );
+    for( int y = 0; y < sz.height; ++y )
+      for( int x = 0; x < sz.width; ++x )
+        img.at< cv::Vec3b >( y, x ) = cv::Vec3b( x * 255 / sz.width, y * 255 / sz.height, 128 );
+
+    AplCam::PreparedFrame frame( img );
+    EXPECT_TRUE( frame.undistortedGray().empty() );
+
+    frame.setUndistorter( undistorter );
+    const cv::Mat &out( frame.undistortedGray() );
+    ASSERT_EQ( CV_8UC1, out.type() );
+    ASSERT_EQ( undistorter->dstSize(), out.size() );
+
+    cv::Mat gray, expected;
+    cv::cvtColor( img, gray, CV_BGR2GRAY );
+    cv::resize( gray, expected, out.size(), 0, 0, cv::INTER_AREA );
+
+    const cv::Rect interior( 2, 2, out.cols-4, out.rows-4 );
+    double maxDiff;
+    cv::minMaxLoc( cv::abs( cv::Mat_< int >( out(interior) ) - cv::Mat_< int >( expected(interior) ) ),
+                   NULL, &maxDiff );
+    EXPECT_LE( maxDiff, 2 );
+
+    // Second request comes from the cache
+    const unsigned int misses = frame.misses();
+    frame.undistortedGray();
+    EXPECT_EQ( misses, frame.misses() );
+  }
+
+}
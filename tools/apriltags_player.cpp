@@ -20,18 +20,14 @@ class AprilTagSplitterApp : public SplitterApp {
         : SplitterApp( options )
       {;}
 
-      virtual bool processSplitFrame( Mat &img, Mat &toDisplay )
+      virtual bool processSplitFrame( PreparedFrame &frame, Mat &toDisplay )
       {
         TagDetector detector( AprilTags::tagCodes36h11 );
 
-        Mat grey;
-        cvtColor( img, grey, CV_BGR2GRAY );
-        toDisplay = grey;
+        toDisplay = frame.gray().clone();
 
-
-        Mat equalized( grey.size(), grey.type() );
-        Ptr<CLAHE> clahe = createCLAHE( 40, Size(4,4));
-        clahe->apply( grey, equalized );
+        // equalized() reuses one CLAHE rather than building one per frame
+        const Mat &equalized( frame.equalized( 40, Size(4,4) ) );
 
         vector<TagDetection> tags = detector.extractTags( equalized );
 
@@ -0,0 +1,141 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <memory>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+#include <tclap/CmdLine.h>
+#include <glog/logging.h>
+
+#include "AplCam/board/board.h"
+#include "AplCam/board_tracker.h"
+#include "AplCam/detection/detection.h"
+#include "AplCam/detection/flat_detections.h"
+#include "AplCam/detection_archive.h"
+#include "AplCam/prepared_frame.h"
+
+using namespace std;
+using namespace cv;
+using namespace AplCam;
+
+// Runs a board's detector over every frame of a video, optionally with
+// BoardTracker's crop-first search, and writes the results to a
+// DetectionArchive.
+
+struct DetectOpts {
+ public:
+  DetectOpts()
+      : track( false ), maxFrames( -1 )
+  {;}
+
+  bool track;
+  int maxFrames;
+  string boardFile, videoFile, archiveFile;
+
+  bool parseOpts( int argc, char **argv, stringstream &msg )
+  {
+    try {
+      TCLAP::CmdLine cmd("Detect a board in every frame of a video", ' ', "0.1" );
+
+      TCLAP::SwitchArg trackArg("t", "track", "Search a crop around the predicted board first", cmd, track );
+      TCLAP::ValueArg< int > maxFramesArg("n", "frames", "Stop after this many frames", false, maxFrames, "frames", cmd );
+      TCLAP::ValueArg< string > archiveArg("o", "archive", "Detection archive to write", false, "", "file", cmd );
+
+      TCLAP::UnlabeledValueArg< string > boardArg("board", "Board file", true, "", "board", cmd );
+      TCLAP::UnlabeledValueArg< string > videoArg("video", "Video file", true, "", "video", cmd );
+
+      cmd.parse( argc, argv );
+
+      track = trackArg.getValue();
+      maxFrames = maxFramesArg.getValue();
+      archiveFile = archiveArg.getValue();
+      boardFile = boardArg.getValue();
+      videoFile = videoArg.getValue();
+    } catch( TCLAP::ArgException &e )
+    {
+      LOG(ERROR) << "Parsing error: " << e.error() << " for " << e.argId();
+      return false;
+    }
+
+    return validate( msg );
+  }
+
+  bool validate( stringstream &msg )
+  {
+    return true;
+  }
+};
+
+
+int main( int argc, char **argv )
+{
+  google::InitGoogleLogging( argv[0] );
+  FLAGS_logtostderr = true;
+
+  DetectOpts opts;
+  stringstream msg;
+  if( !opts.parseOpts( argc, argv, msg ) ) {
+    cout << msg.str() << endl;
+    exit(-1);
+  }
+
+  unique_ptr< Board > board( Board::load( opts.boardFile, "board" ) );
+  if( !board ) {
+    cerr << "Couldn't load a board from \"" << opts.boardFile << "\"" << endl;
+    exit(-1);
+  }
+
+  VideoCapture vid( opts.videoFile );
+  if( !vid.isOpened() ) {
+    cerr << "Couldn't open video source \"" << opts.videoFile << "\"" << endl;
+    exit(-1);
+  }
+
+  unique_ptr< BoardTracker > tracker;
+  if( opts.track ) tracker.reset( new BoardTracker( *board ) );
+
+  FlatDetections flat;
+  Mat img;
+  int frame = 0, found = 0;
+  double detectSec = 0;
+
+  while( (opts.maxFrames < 0 || frame < opts.maxFrames) && vid.read( img ) ) {
+    const int64 start = getTickCount();
+    PreparedFrame prepared( img );
+    unique_ptr< Detection > det( tracker ? tracker->detect( prepared ) : board->detect( prepared ) );
+    detectSec += (getTickCount() - start) / getTickFrequency();
+
+    if( det && det->good() ) {
+      flat.add( *det, frame );
+      ++found;
+    }
+
+    ++frame;
+  }
+
+  if( frame == 0 ) {
+    cerr << "No frames read from \"" << opts.videoFile << "\"" << endl;
+    exit(-1);
+  }
+
+  cout << "Found the board in " << found << " of " << frame << " frames, "
+       << fixed << setprecision(2) << 1000 * detectSec / frame << " ms/frame" << endl;
+
+  if( tracker ) {
+    const BoardTracker::Stats &stats( tracker->stats() );
+    cout << "Crop hits " << stats.cropHits << ", crop misses " << stats.cropMisses
+         << ", full frame searches " << stats.fullFrame << endl;
+  }
+
+  if( !opts.archiveFile.empty() ) {
+    const Size sz( vid.get( CV_CAP_PROP_FRAME_WIDTH ), vid.get( CV_CAP_PROP_FRAME_HEIGHT ) );
+    if( !DetectionArchive::Write( opts.archiveFile, flat, frame, sz, vid.get( CV_CAP_PROP_FPS ) ) ) {
+      cerr << "Unable to write \"" << opts.archiveFile << "\"" << endl;
+      exit(-1);
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,182 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <cmath>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+#include <tclap/CmdLine.h>
+#include <glog/logging.h>
+
+#include "AplCam/hough_circles.h"
+
+using namespace std;
+using namespace cv;
+
+// Times AplCam::HoughCircles against cv::HoughCircles on the same frames
+// (videos or still images), and reports how often they agree.
+
+struct BenchOpts {
+ public:
+  BenchOpts()
+      : dp( 2 ), minDist( 4 ), param1( 100 ), param2( 100 ),
+        minRadius( 0 ), maxRadius( 0 ), maxFrames( 100 ), step( 1 )
+  {;}
+
+  double dp, minDist, param1, param2;
+  int minRadius, maxRadius, maxFrames, step;
+  vector< string > inFiles;
+
+  bool parseOpts( int argc, char **argv, stringstream &msg )
+  {
+    try {
+      TCLAP::CmdLine cmd("Benchmark AplCam::HoughCircles against cv::HoughCircles", ' ', "0.1" );
+
+      TCLAP::ValueArg< double > dpArg("", "dp", "Accumulator resolution", false, dp, "ratio", cmd );
+      TCLAP::ValueArg< double > minDistArg("", "min-dist", "Minimum distance between centers", false, minDist, "pixels", cmd );
+      TCLAP::ValueArg< double > param1Arg("", "canny", "Upper Canny threshold", false, param1, "threshold", cmd );
+      TCLAP::ValueArg< double > param2Arg("", "votes", "Accumulator threshold", false, param2, "votes", cmd );
+      TCLAP::ValueArg< int > minRadiusArg("", "min-radius", "Minimum radius", false, minRadius, "pixels", cmd );
+      TCLAP::ValueArg< int > maxRadiusArg("", "max-radius", "Maximum radius (0 for no limit)", false, maxRadius, "pixels", cmd );
+      TCLAP::ValueArg< int > maxFramesArg("n", "frames", "Maximum frames per video", false, maxFrames, "frames", cmd );
+      TCLAP::ValueArg< int > stepArg("", "step", "Use every n'th video frame", false, step, "frames", cmd );
+
+      TCLAP::UnlabeledMultiArg< std::string > fileNamesArg("files", "Videos or images", true, "file names", cmd );
+
+      cmd.parse( argc, argv );
+
+      dp = dpArg.getValue();
+      minDist = minDistArg.getValue();
+      param1 = param1Arg.getValue();
+      param2 = param2Arg.getValue();
+      minRadius = minRadiusArg.getValue();
+      maxRadius = maxRadiusArg.getValue();
+      maxFrames = maxFramesArg.getValue();
+      step = std::max( 1, stepArg.getValue() );
+      inFiles = fileNamesArg.getValue();
+    } catch( TCLAP::ArgException &e )
+    {
+      LOG(ERROR) << "Parsing error: " << e.error() << " for " << e.argId();
+      return false;
+    }
+
+    return validate( msg );
+  }
+
+  bool validate( stringstream &msg )
+  {
+    if( dp <= 0 || minDist <= 0 || param1 <= 0 || param2 <= 0 ) {
+      msg << "dp, min-dist, canny and votes must be positive";
+      return false;
+    }
+
+    return true;
+  }
+};
+
+
+class HoughBench
+{
+ public:
+  HoughBench( BenchOpts &options )
+      : opts( options ), frames( 0 ), cvSec( 0 ), aplSec( 0 ),
+        cvCircles( 0 ), aplCircles( 0 ), matched( 0 )
+  {;}
+
+  int run( void )
+  {
+    for( vector<string>::iterator itr = opts.inFiles.begin(); itr != opts.inFiles.end(); ++itr ) {
+      Mat img( imread( *itr, CV_LOAD_IMAGE_GRAYSCALE ) );
+      if( !img.empty() ) {
+        doFrame( img );
+        continue;
+      }
+
+      VideoCapture vid( *itr );
+      if( !vid.isOpened() ) {
+        cerr << "Couldn't open \"" << *itr << "\"" << endl;
+        return -1;
+      }
+
+      Mat frame, gray;
+      for( int i = 0, used = 0; used < opts.maxFrames && vid.read( frame ); ++i ) {
+        if( i % opts.step ) continue;
+
+        cvtColor( frame, gray, CV_BGR2GRAY );
+        doFrame( gray );
+        ++used;
+      }
+    }
+
+    if( frames == 0 ) {
+      cerr << "No frames read" << endl;
+      return -1;
+    }
+
+    cout << "Frames:            " << frames << endl;
+    cout << fixed << setprecision(2);
+    cout << "cv::HoughCircles:     " << 1000 * cvSec / frames << " ms/frame, " << cvCircles << " circles" << endl;
+    cout << "AplCam::HoughCircles: " << 1000 * aplSec / frames << " ms/frame, " << aplCircles << " circles" << endl;
+    cout << "Speedup:           " << cvSec / std::max( aplSec, 1e-9 ) << "x" << endl;
+    cout << "OpenCV circles also found by AplCam (within dp px): " << matched << " / " << cvCircles << endl;
+
+    return 0;
+  }
+
+ protected:
+
+  // Same preprocessing as CircleBoard::detect
+  void doFrame( const Mat &gray )
+  {
+    Mat blurred;
+    GaussianBlur( gray, blurred, Size(5,5), 0 );
+
+    vector< Vec3f > reference;
+    int64 start = getTickCount();
+    cv::HoughCircles( blurred, reference, CV_HOUGH_GRADIENT, opts.dp, opts.minDist,
+                      opts.param1, opts.param2, opts.minRadius, opts.maxRadius );
+    cvSec += (getTickCount() - start) / getTickFrequency();
+
+    AplCam::Circles_t found;
+    start = getTickCount();
+    AplCam::HoughCircles( blurred, found, CV_HOUGH_GRADIENT, opts.dp, opts.minDist,
+                          opts.param1, opts.param2, opts.minRadius, opts.maxRadius );
+    aplSec += (getTickCount() - start) / getTickFrequency();
+
+    for( size_t i = 0; i < reference.size(); ++i )
+      for( size_t j = 0; j < found.size(); ++j )
+        if( std::hypot( reference[i][0] - found[j][0], reference[i][1] - found[j][1] ) <= std::max( opts.dp, 1.0 ) ) {
+          ++matched;
+          break;
+        }
+
+    ++frames;
+    cvCircles += reference.size();
+    aplCircles += found.size();
+  }
+
+  BenchOpts opts;
+
+  int frames;
+  double cvSec, aplSec;
+  size_t cvCircles, aplCircles, matched;
+};
+
+
+int main( int argc, char **argv )
+{
+  google::InitGoogleLogging( argv[0] );
+  FLAGS_logtostderr = true;
+
+  BenchOpts opts;
+  stringstream msg;
+  if( !opts.parseOpts( argc, argv, msg ) ) {
+    cout << msg.str() << endl;
+    exit(-1);
+  }
+
+  HoughBench bench( opts );
+  return bench.run();
+}
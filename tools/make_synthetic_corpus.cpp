@@ -0,0 +1,120 @@
+#include <iostream>
+#include <sstream>
+#include <memory>
+
+#include <tclap/CmdLine.h>
+#include <glog/logging.h>
+
+#include "AplCam/board/board.h"
+#include "AplCam/synthetic_corpus.h"
+
+using namespace std;
+using namespace AplCam;
+
+struct CorpusOpts {
+ public:
+  CorpusOpts()
+      : count( 100 ), width( 1280 ), height( 960 ), focalLength( 0 ),
+        noise( 2.0 ), seed( 1 )
+  {;}
+
+  int count, width, height;
+  double focalLength, noise;
+  unsigned long seed;
+  vector< double > distCoeffs;
+
+  string boardFile, archiveFile, groundTruthFile, imageDir;
+
+  bool parseOpts( int argc, char **argv, stringstream &msg )
+  {
+    try {
+      TCLAP::CmdLine cmd("Render a reproducible corpus of synthetic calibration images", ' ', "0.1" );
+
+      TCLAP::ValueArg< int > countArg("n", "count", "Number of images", false, count, "count", cmd );
+      TCLAP::ValueArg< int > widthArg("", "width", "Image width", false, width, "pixels", cmd );
+      TCLAP::ValueArg< int > heightArg("", "height", "Image height", false, height, "pixels", cmd );
+      TCLAP::ValueArg< double > focalArg("f", "focal-length", "Focal length (default is image width)", false, focalLength, "pixels", cmd );
+      TCLAP::MultiArg< double > distArg("k", "distortion", "Distortion coefficient, in OpenCV order (k1 k2 p1 p2 [k3]);  repeat for each", false, "coeff", cmd );
+      TCLAP::ValueArg< double > noiseArg("", "noise", "Pixel noise sigma", false, noise, "gray levels", cmd );
+      TCLAP::ValueArg< unsigned long > seedArg("s", "seed", "Random seed", false, seed, "seed", cmd );
+
+      TCLAP::ValueArg< string > truthArg("", "ground-truth", "YAML file for intrinsics and poses", false, "", "file", cmd );
+      TCLAP::ValueArg< string > imageDirArg("", "image-dir", "Directory for the rendered images", false, "", "dir", cmd );
+
+      TCLAP::UnlabeledValueArg< string > boardArg("board", "Board file", true, "", "board", cmd );
+      TCLAP::UnlabeledValueArg< string > archiveArg("archive", "Detection archive to write", true, "", "archive", cmd );
+
+      cmd.parse( argc, argv );
+
+      count = countArg.getValue();
+      width = widthArg.getValue();
+      height = heightArg.getValue();
+      focalLength = focalArg.getValue();
+      distCoeffs = distArg.getValue();
+      noise = noiseArg.getValue();
+      seed = seedArg.getValue();
+
+      groundTruthFile = truthArg.getValue();
+      imageDir = imageDirArg.getValue();
+      boardFile = boardArg.getValue();
+      archiveFile = archiveArg.getValue();
+
+    } catch( TCLAP::ArgException &e )
+    {
+      LOG(ERROR) << "Parsing error: " << e.error() << " for " << e.argId();
+      return false;
+    }
+
+    return validate( msg );
+  }
+
+  bool validate( stringstream &msg )
+  {
+    if( count <= 0 ) {
+      msg << "Count must be positive";
+      return false;
+    }
+
+    if( width <= 0 || height <= 0 ) {
+      msg << "Image size must be positive";
+      return false;
+    }
+
+    if( !distCoeffs.empty() && distCoeffs.size() != 4 && distCoeffs.size() != 5 ) {
+      msg << "Give four or five distortion coefficients";
+      return false;
+    }
+
+    return true;
+  }
+};
+
+
+int main( int argc, char **argv )
+{
+  google::InitGoogleLogging( argv[0] );
+  FLAGS_logtostderr = true;
+
+  CorpusOpts opts;
+  stringstream msg;
+  if( !opts.parseOpts( argc, argv, msg ) ) {
+    cout << msg.str() << endl;
+    return -1;
+  }
+
+  unique_ptr< Board > board( Board::load( opts.boardFile, "board" ) );
+
+  SyntheticCorpus::Params params;
+  params.imageSize = cv::Size( opts.width, opts.height );
+  params.focalLength = opts.focalLength;
+  params.distCoeffs = opts.distCoeffs;
+  params.noiseSigma = opts.noise;
+  params.seed = opts.seed;
+
+  SyntheticCorpus corpus( *board, params );
+  if( !corpus.generate( opts.count, opts.archiveFile, opts.groundTruthFile, opts.imageDir ) )
+    return -1;
+
+  cout << "Wrote " << opts.count << " frames to " << opts.archiveFile << endl;
+  return 0;
+}